@@ -136,6 +136,17 @@ static int binder_set_stop_on_user_error(const char *val,
 module_param_call(stop_on_user_error, binder_set_stop_on_user_error,
 	param_get_int, &binder_stop_on_user_error, 0644);
 
+static bool binder_latency_stats;
+module_param_named(latency_stats, binder_latency_stats, bool, 0644);
+
+static void binder_latency_add(struct binder_latency_hist *hist, u64 ns)
+{
+	u64 us = div_u64(ns, NSEC_PER_USEC);
+
+	hist->count[min_t(unsigned int, fls64(us),
+			  BINDER_LATENCY_BUCKETS - 1)]++;
+}
+
 #define binder_debug(mask, x...) \
 	do { \
 		if (binder_debug_mask & mask) \
@@ -281,6 +292,8 @@ _binder_inner_proc_lock(struct binder_proc *proc, int line)
 	binder_debug(BINDER_DEBUG_SPINLOCKS,
 		     "%s: line=%d\n", __func__, line);
 	spin_lock(&proc->inner_lock);
+	binder_proc_latency(proc)->lock_start_ns =
+		binder_latency_stats ? ktime_get_ns() : 0;
 }
 
 /**
@@ -294,8 +307,13 @@ static void
 _binder_inner_proc_unlock(struct binder_proc *proc, int line)
 	__releases(&proc->inner_lock)
 {
+	struct binder_proc_latency *latency = binder_proc_latency(proc);
+
 	binder_debug(BINDER_DEBUG_SPINLOCKS,
 		     "%s: line=%d\n", __func__, line);
+	if (latency->lock_start_ns)
+		binder_latency_add(&latency->lock,
+				   ktime_get_ns() - latency->lock_start_ns);
 	spin_unlock(&proc->inner_lock);
 }
 
@@ -898,25 +916,35 @@ static struct binder_node *binder_new_node(struct binder_proc *proc,
 					   struct flat_binder_object *fp)
 {
 	struct binder_node *node;
-	struct binder_node *new_node = kzalloc(sizeof(*node), GFP_KERNEL);
+	struct binder_node_ext *new_enode;
+	struct binder_node *new_node;
 
-	if (!new_node)
+	new_enode = kzalloc(sizeof(*new_enode), GFP_KERNEL);
+	if (!new_enode)
 		return NULL;
+	/* histograms are optional, go without them on failure */
+	if (binder_latency_stats)
+		new_enode->latency = kzalloc(sizeof(*new_enode->latency),
+					     GFP_KERNEL);
+	new_node = &new_enode->node;
 	binder_inner_proc_lock(proc);
 	node = binder_init_node_ilocked(proc, new_node, fp);
 	binder_inner_proc_unlock(proc);
-	if (node != new_node)
+	if (node != new_node) {
 		/*
 		 * The node was already added by another thread
 		 */
-		kfree(new_node);
+		kfree(new_enode->latency);
+		kfree(new_enode);
+	}
 
 	return node;
 }
 
 static void binder_free_node(struct binder_node *node)
 {
-	kfree(node);
+	kfree(binder_node_latency(node));
+	kfree(container_of(node, struct binder_node_ext, node));
 	binder_stats_deleted(BINDER_STAT_NODE);
 }
 
@@ -2884,6 +2912,13 @@ static int binder_proc_transaction(struct binder_transaction *t,
 		return proc->is_frozen ? BR_FROZEN_REPLY : BR_DEAD_REPLY;
 	}
 
+	/*
+	 * Async transactions parked on node->async_todo keep this time, so
+	 * their queue latency includes waiting for the previous one.
+	 */
+	binder_txn_ext(t)->enqueue_ns = binder_latency_stats ?
+		ktime_get_ns() : 0;
+
 	if (!thread && !pending_async)
 		thread = binder_select_thread_ilocked(proc);
 
@@ -2991,6 +3026,98 @@ static struct binder_node *binder_get_node_refs_for_txn(
 	return target_node;
 }
 
+/*
+ * Maximum number of async transactions to the same node that are delivered
+ * ahead of the buffer of the previous one being freed.
+ */
+#define BINDER_ASYNC_BATCH_MAX 16
+
+/**
+ * binder_batch_async_ilocked() - Queue the next async transaction after @t
+ * @thread: thread reading @t
+ * @t:      async transaction being delivered to @thread
+ *
+ * Async transactions to a node are serialized: the next one is only queued
+ * once the buffer of the previous one is freed. Take the next one off
+ * node->async_todo and put it first in @thread's todo list instead, so that
+ * the thread picks it up on its next read without waiting for the free and
+ * a wakeup. It is not delivered in the same read as @t: the handler of @t
+ * may make a sync call, and anything userspace already holds would then
+ * run nested in it. Only a looper thread with no transaction in progress
+ * batches, and binder_unbatch_async_ilocked() takes the transaction back
+ * when the thread starts an outgoing sync transaction, so it is only
+ * delivered once the thread is back in its loop. The node counts how many
+ * extra buffers are outstanding, see binder_free_buf().
+ *
+ * Requires the proc->inner_lock to be held.
+ *
+ * Return: true if a transaction was moved to @thread's todo list
+ */
+static bool binder_batch_async_ilocked(struct binder_thread *thread,
+				       struct binder_transaction *t)
+{
+	struct binder_node *node = t->buffer->target_node;
+	struct binder_node_ext *enode;
+	struct binder_work *w;
+
+	assert_spin_locked(&thread->proc->inner_lock);
+
+	if (!node || !(t->flags & TF_ONE_WAY))
+		return false;
+	if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
+				BINDER_LOOPER_STATE_ENTERED)) ||
+	    thread->transaction_stack)
+		return false;
+	enode = binder_node_ext(node);
+	if (enode->async_batched >= BINDER_ASYNC_BATCH_MAX)
+		return false;
+
+	w = binder_dequeue_work_head_ilocked(&node->async_todo);
+	if (!w)
+		return false;
+
+	enode->async_batched++;
+	binder_txn_ext(container_of(w, struct binder_transaction,
+				    work))->async_batched = true;
+	list_add(&w->entry, &thread->todo);
+	thread->process_todo = true;
+	return true;
+}
+
+/**
+ * binder_unbatch_async_ilocked() - Return batched transactions to their nodes
+ * @thread: thread starting an outgoing sync transaction, or exiting
+ *
+ * Put async transactions queued to @thread by binder_batch_async_ilocked()
+ * back at the head of their node's async_todo, in order, where the free of
+ * the previous buffer picks them up as usual.
+ *
+ * Requires the proc->inner_lock to be held.
+ */
+static void binder_unbatch_async_ilocked(struct binder_thread *thread)
+{
+	struct binder_transaction_ext *et;
+	struct binder_work *w, *tmp;
+	struct binder_node *node;
+
+	assert_spin_locked(&thread->proc->inner_lock);
+
+	list_for_each_entry_safe_reverse(w, tmp, &thread->todo, entry) {
+		if (w->type != BINDER_WORK_TRANSACTION)
+			continue;
+		et = binder_txn_ext(container_of(w, struct binder_transaction,
+						 work));
+		if (!et->async_batched)
+			continue;
+		et->async_batched = false;
+		node = et->t.buffer->target_node;
+		binder_node_ext(node)->async_batched--;
+		list_move(&w->entry, &node->async_todo);
+	}
+	if (binder_worklist_empty_ilocked(&thread->todo))
+		thread->process_todo = false;
+}
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
 			       struct binder_transaction_data *tr, int reply,
@@ -3065,6 +3192,21 @@ static void binder_transaction(struct binder_proc *proc,
 			goto err_bad_call_stack;
 		}
 		thread->transaction_stack = in_reply_to->to_parent;
+		if (binder_txn_ext(in_reply_to)->dequeue_ns) {
+			u64 delta = ktime_get_ns() -
+				binder_txn_ext(in_reply_to)->dequeue_ns;
+			struct binder_node_latency *node_latency = NULL;
+
+			binder_latency_add(&binder_proc_latency(proc)->reply,
+					   delta);
+			/* the buffer holds a ref on the node until freed */
+			if (in_reply_to->buffer &&
+			    in_reply_to->buffer->target_node)
+				node_latency = binder_node_latency(
+					in_reply_to->buffer->target_node);
+			if (node_latency)
+				binder_latency_add(&node_latency->reply, delta);
+		}
 		binder_inner_proc_unlock(proc);
 		target_thread = binder_get_txn_from_and_acq_inner(in_reply_to);
 		if (target_thread == NULL) {
@@ -3217,7 +3359,7 @@ static void binder_transaction(struct binder_proc *proc,
 	trace_android_rvh_binder_transaction(target_proc, proc, thread, tr);
 
 	/* TODO: reuse incoming transaction for reply */
-	t = kzalloc(sizeof(*t), GFP_KERNEL);
+	t = kzalloc(sizeof(struct binder_transaction_ext), GFP_KERNEL);
 	if (t == NULL) {
 		return_error = BR_FAILED_REPLY;
 		return_error_param = -ENOMEM;
@@ -3693,6 +3835,7 @@ static void binder_transaction(struct binder_proc *proc,
 	} else if (!(t->flags & TF_ONE_WAY)) {
 		BUG_ON(t->buffer->async_transaction != 0);
 		binder_inner_proc_lock(proc);
+		binder_unbatch_async_ilocked(thread);
 		/*
 		 * Defer the TRANSACTION_COMPLETE, so we don't return to
 		 * userspace immediately; this allows the target process to
@@ -3846,6 +3989,15 @@ binder_free_buf(struct binder_proc *proc,
 		binder_node_inner_lock(buf_node);
 		BUG_ON(!buf_node->has_async_transaction);
 		BUG_ON(buf_node->proc != proc);
+		/*
+		 * With a batch delivered, only the last buffer freed lets the
+		 * next transaction through.
+		 */
+		if (binder_node_ext(buf_node)->async_batched) {
+			binder_node_ext(buf_node)->async_batched--;
+			binder_node_inner_unlock(buf_node);
+			goto release;
+		}
 		w = binder_dequeue_work_head_ilocked(
 				&buf_node->async_todo);
 		if (!w) {
@@ -3859,6 +4011,7 @@ binder_free_buf(struct binder_proc *proc,
 		}
 		binder_node_inner_unlock(buf_node);
 	}
+release:
 	trace_binder_transaction_buffer_release(buffer);
 	binder_release_entire_buffer(proc, thread, buffer, is_failure);
 	binder_alloc_free_buf(&proc->alloc, buffer);
@@ -4532,8 +4685,26 @@ static int binder_thread_read(struct binder_proc *proc,
 
 		switch (w->type) {
 		case BINDER_WORK_TRANSACTION: {
-			binder_inner_proc_unlock(proc);
+			struct binder_transaction_ext *et;
+
 			t = container_of(w, struct binder_transaction, work);
+			et = binder_txn_ext(t);
+			et->async_batched = false;
+			if (et->enqueue_ns && t->buffer->target_node) {
+				struct binder_node_latency *node_latency =
+					binder_node_latency(
+						t->buffer->target_node);
+
+				et->dequeue_ns = ktime_get_ns();
+				binder_latency_add(
+					&binder_proc_latency(proc)->queue,
+					et->dequeue_ns - et->enqueue_ns);
+				if (node_latency)
+					binder_latency_add(&node_latency->queue,
+						et->dequeue_ns - et->enqueue_ns);
+			}
+			binder_batch_async_ilocked(thread, t);
+			binder_inner_proc_unlock(proc);
 		} break;
 		case BINDER_WORK_RETURN_ERROR: {
 			struct binder_error *e = container_of(
@@ -5038,6 +5209,7 @@ static int binder_thread_release(struct binder_proc *proc,
 		__acquire(&t->lock);
 	}
 	thread->is_dead = true;
+	binder_unbatch_async_ilocked(thread);
 
 	while (t) {
 		last_t = t;
@@ -6458,6 +6630,81 @@ static int state_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static bool binder_latency_hist_empty(struct binder_latency_hist *hist)
+{
+	int i;
+
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++)
+		if (hist->count[i])
+			return false;
+	return true;
+}
+
+static void print_binder_latency_hist(struct seq_file *m, const char *prefix,
+				      const char *name,
+				      struct binder_latency_hist *hist)
+{
+	int i;
+
+	if (binder_latency_hist_empty(hist))
+		return;
+
+	seq_printf(m, "%s%s:", prefix, name);
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++)
+		if (hist->count[i])
+			seq_printf(m, " %uus:%u", i ? 1U << (i - 1) : 0,
+				   hist->count[i]);
+	seq_puts(m, "\n");
+}
+
+static void print_binder_proc_latency(struct seq_file *m,
+				      struct binder_proc *proc)
+{
+	struct binder_proc_latency latency;
+	struct binder_node_latency *node_latency;
+	struct binder_node *node;
+	struct rb_node *n;
+
+	seq_printf(m, "proc %d\n", proc->pid);
+	binder_inner_proc_lock(proc);
+	latency = *binder_proc_latency(proc);
+	for (n = rb_first(&proc->nodes); n; n = rb_next(n)) {
+		node = rb_entry(n, struct binder_node, rb_node);
+		node_latency = binder_node_latency(node);
+		if (!node_latency ||
+		    (binder_latency_hist_empty(&node_latency->queue) &&
+		     binder_latency_hist_empty(&node_latency->reply)))
+			continue;
+		seq_printf(m, "  node %d\n", node->debug_id);
+		print_binder_latency_hist(m, "    ", "queue",
+					  &node_latency->queue);
+		print_binder_latency_hist(m, "    ", "reply",
+					  &node_latency->reply);
+	}
+	binder_inner_proc_unlock(proc);
+
+	print_binder_latency_hist(m, "  ", "queue", &latency.queue);
+	print_binder_latency_hist(m, "  ", "reply", &latency.reply);
+	print_binder_latency_hist(m, "  ", "inner_lock", &latency.lock);
+}
+
+/*
+ * Latency histograms per proc and node, as "<lower bound>us:<count>" for
+ * the buckets that are not empty.
+ */
+static int latency_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+
+	seq_puts(m, "binder latency:\n");
+	mutex_lock(&binder_procs_lock);
+	hlist_for_each_entry(proc, &binder_procs, proc_node)
+		print_binder_proc_latency(m, proc);
+	mutex_unlock(&binder_procs_lock);
+
+	return 0;
+}
+
 static int stats_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc;
@@ -6566,6 +6813,7 @@ DEFINE_SHOW_ATTRIBUTE(state);
 DEFINE_SHOW_ATTRIBUTE(stats);
 DEFINE_SHOW_ATTRIBUTE(transactions);
 DEFINE_SHOW_ATTRIBUTE(transaction_log);
+DEFINE_SHOW_ATTRIBUTE(latency);
 
 const struct binder_debugfs_entry binder_debugfs_entries[] = {
 	{
@@ -6598,6 +6846,12 @@ const struct binder_debugfs_entry binder_debugfs_entries[] = {
 		.fops = &transaction_log_fops,
 		.data = &binder_transaction_log_failed,
 	},
+	{
+		.name = "latency",
+		.mode = 0444,
+		.fops = &latency_fops,
+		.data = NULL,
+	},
 	{} /* terminator */
 };
 
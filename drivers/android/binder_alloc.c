@@ -381,6 +381,53 @@ static bool debug_low_async_space_locked(struct binder_alloc *alloc, int pid)
 	return false;
 }
 
+static struct binder_alloc_class *
+binder_alloc_get_class(struct binder_alloc *alloc, size_t size)
+{
+	int index = 0;
+
+	if (size > BINDER_ALLOC_SMALL_MAX)
+		return NULL;
+	if (size > (1U << BINDER_ALLOC_CLASS_MIN_SHIFT))
+		index = order_base_2(size) - BINDER_ALLOC_CLASS_MIN_SHIFT;
+	return &alloc->classes[index];
+}
+
+static size_t binder_alloc_class_size(struct binder_alloc *alloc,
+				      struct binder_alloc_class *class)
+{
+	return 1U << (class - alloc->classes + BINDER_ALLOC_CLASS_MIN_SHIFT);
+}
+
+static void binder_release_buf_locked(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer,
+				      size_t buffer_size);
+
+/*
+ * Return the cached small buffers to the free_buffers tree, so that their
+ * space can be merged again. Returns true if anything was released.
+ */
+static bool binder_alloc_drain_classes_locked(struct binder_alloc *alloc)
+{
+	struct binder_buffer *buffer, *tmp;
+	bool drained = false;
+	int i;
+
+	for (i = 0; i < BINDER_ALLOC_CLASSES; i++) {
+		struct binder_alloc_class *class = &alloc->classes[i];
+
+		list_for_each_entry_safe(buffer, tmp, &class->buffers,
+					 class_entry) {
+			list_del(&buffer->class_entry);
+			binder_release_buf_locked(alloc, buffer,
+				binder_alloc_buffer_size(alloc, buffer));
+			drained = true;
+		}
+		class->count = 0;
+	}
+	return drained;
+}
+
 static struct binder_buffer *binder_alloc_new_buf_locked(
 				struct binder_alloc *alloc,
 				size_t data_size,
@@ -389,7 +436,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 				int is_async,
 				int pid)
 {
-	struct rb_node *n = alloc->free_buffers.rb_node;
+	struct binder_alloc_class *class;
+	struct rb_node *n;
 	struct binder_buffer *buffer;
 	size_t buffer_size;
 	struct rb_node *best_fit = NULL;
@@ -423,6 +471,9 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 	}
 	/* Pad 0-size buffers so they get assigned unique addresses */
 	size = max(size, sizeof(void *));
+	class = binder_alloc_get_class(alloc, size);
+	if (class)
+		size = binder_alloc_class_size(alloc, class);
 
 	trace_android_vh_binder_alloc_new_buf_locked(size, alloc, is_async);
 	if (is_async &&
@@ -433,6 +484,19 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 		return ERR_PTR(-ENOSPC);
 	}
 
+	if (class && class->count) {
+		buffer = list_first_entry(&class->buffers, struct binder_buffer,
+					  class_entry);
+		list_del(&buffer->class_entry);
+		class->count--;
+		binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
+			     "%d: binder_alloc_buf size %zd got cached %pK\n",
+			      alloc->pid, size, buffer);
+		goto got_buffer;
+	}
+
+retry:
+	n = alloc->free_buffers.rb_node;
 	while (n) {
 		buffer = rb_entry(n, struct binder_buffer, rb_node);
 		BUG_ON(!buffer->free);
@@ -448,6 +512,8 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 			break;
 		}
 	}
+	if (best_fit == NULL && binder_alloc_drain_classes_locked(alloc))
+		goto retry;
 	if (best_fit == NULL) {
 		size_t allocated_buffers = 0;
 		size_t largest_alloc_size = 0;
@@ -522,6 +588,7 @@ static struct binder_buffer *binder_alloc_new_buf_locked(
 
 	rb_erase(best_fit, &alloc->free_buffers);
 	buffer->free = 0;
+got_buffer:
 	buffer->allow_user_free = 0;
 	binder_insert_allocated_buffer_locked(alloc, buffer);
 	binder_alloc_debug(BINDER_DEBUG_BUFFER_ALLOC,
@@ -653,6 +720,7 @@ static void binder_delete_free_buffer(struct binder_alloc *alloc,
 static void binder_free_buf_locked(struct binder_alloc *alloc,
 				   struct binder_buffer *buffer)
 {
+	struct binder_alloc_class *class;
 	size_t size, buffer_size;
 
 	buffer_size = binder_alloc_buffer_size(alloc, buffer);
@@ -678,12 +746,35 @@ static void binder_free_buf_locked(struct binder_alloc *alloc,
 			      alloc->pid, size, alloc->free_async_space);
 	}
 
+	rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
+
+	/*
+	 * Keep small buffers in their size class, still mapped and not free
+	 * as far as the neighbouring buffers are concerned. Buffers carved
+	 * for a class have exactly the class size. Nothing is cached once the
+	 * vma is gone, the proc is being torn down then.
+	 */
+	class = binder_alloc_get_class(alloc, buffer_size);
+	if (class && class->count < BINDER_ALLOC_CLASS_CACHED &&
+	    buffer_size == binder_alloc_class_size(alloc, class) &&
+	    binder_alloc_get_vma(alloc)) {
+		list_add(&buffer->class_entry, &class->buffers);
+		class->count++;
+		return;
+	}
+
+	binder_release_buf_locked(alloc, buffer, buffer_size);
+}
+
+static void binder_release_buf_locked(struct binder_alloc *alloc,
+				      struct binder_buffer *buffer,
+				      size_t buffer_size)
+{
 	binder_update_page_range(alloc, 0,
 		(void __user *)PAGE_ALIGN((uintptr_t)buffer->user_data),
 		(void __user *)(((uintptr_t)
 			  buffer->user_data + buffer_size) & PAGE_MASK));
 
-	rb_erase(&buffer->rb_node, &alloc->allocated_buffers);
 	buffer->free = 1;
 	if (!list_is_last(&buffer->entry, &alloc->buffers)) {
 		struct binder_buffer *next = binder_buffer_next(buffer);
@@ -832,6 +923,7 @@ void binder_alloc_deferred_release(struct binder_alloc *alloc)
 		binder_free_buf_locked(alloc, buffer);
 		buffers++;
 	}
+	binder_alloc_drain_classes_locked(alloc);
 
 	while (!list_empty(&alloc->buffers)) {
 		buffer = list_first_entry(&alloc->buffers,
@@ -1082,9 +1174,13 @@ static struct shrinker binder_shrinker = {
  */
 void binder_alloc_init(struct binder_alloc *alloc)
 {
+	int i;
+
 	alloc->pid = current->group_leader->pid;
 	mutex_init(&alloc->mutex);
 	INIT_LIST_HEAD(&alloc->buffers);
+	for (i = 0; i < BINDER_ALLOC_CLASSES; i++)
+		INIT_LIST_HEAD(&alloc->classes[i].buffers);
 }
 
 int binder_alloc_shrinker_init(void)
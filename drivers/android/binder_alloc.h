@@ -22,6 +22,8 @@ struct binder_transaction;
  * struct binder_buffer - buffer used for binder transactions
  * @entry:              entry alloc->buffers
  * @rb_node:            node for allocated_buffers/free_buffers rb trees
+ * @class_entry:        entry in a size class free list while the buffer is
+ *                      cached there
  * @free:               %true if buffer is free
  * @clear_on_free:      %true if buffer must be zeroed after use
  * @allow_user_free:    %true if user is allowed to free buffer
@@ -41,8 +43,11 @@ struct binder_transaction;
  */
 struct binder_buffer {
 	struct list_head entry; /* free and allocated entries by address */
-	struct rb_node rb_node; /* free entry by size or allocated entry */
-				/* by address */
+	union {
+		struct rb_node rb_node; /* free entry by size or allocated */
+					/* entry by address */
+		struct list_head class_entry;
+	};
 	unsigned free:1;
 	unsigned clear_on_free:1;
 	unsigned allow_user_free:1;
@@ -72,6 +77,29 @@ struct binder_lru_page {
 	struct binder_alloc *alloc;
 };
 
+/*
+ * Buffers of up to BINDER_ALLOC_SMALL_MAX bytes are rounded up to one of
+ * BINDER_ALLOC_CLASSES power-of-two size classes. When freed, up to
+ * BINDER_ALLOC_CLASS_CACHED of them per class are kept with their pages
+ * mapped, so they can be handed out again without a best-fit search or a
+ * split/merge of the free_buffers tree.
+ */
+#define BINDER_ALLOC_CLASSES		4
+#define BINDER_ALLOC_CLASS_MIN_SHIFT	5
+#define BINDER_ALLOC_SMALL_MAX \
+	(1U << (BINDER_ALLOC_CLASS_MIN_SHIFT + BINDER_ALLOC_CLASSES - 1))
+#define BINDER_ALLOC_CLASS_CACHED	16
+
+/**
+ * struct binder_alloc_class - cached free buffers of one size class
+ * @buffers: list of cached buffers, linked through class_entry
+ * @count:   number of buffers on @buffers
+ */
+struct binder_alloc_class {
+	struct list_head buffers;
+	int count;
+};
+
 /**
  * struct binder_alloc - per-binder proc state for binder allocator
  * @vma:                vm_area_struct passed to mmap_handler
@@ -92,6 +120,7 @@ struct binder_lru_page {
  * @pages_high:         high watermark of offset in @pages
  * @oneway_spam_detected: %true if oneway spam detection fired, clear that
  * flag once the async buffer has returned to a healthy state
+ * @classes:            cached small buffers, see BINDER_ALLOC_SMALL_MAX
  *
  * Bookkeeping structure for per-proc address space management for binder
  * buffers. It is normally initialized during binder_init() and binder_mmap()
@@ -113,6 +142,7 @@ struct binder_alloc {
 	int pid;
 	size_t pages_high;
 	bool oneway_spam_detected;
+	struct binder_alloc_class classes[BINDER_ALLOC_CLASSES];
 };
 
 #ifdef CONFIG_ANDROID_BINDER_IPC_SELFTEST
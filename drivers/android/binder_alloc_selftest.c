@@ -10,11 +10,17 @@
 
 #include <linux/mm_types.h>
 #include <linux/err.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
 #include "binder_alloc.h"
 
 #define BUFFER_NUM 5
 #define BUFFER_MIN_SIZE (PAGE_SIZE / 8)
 
+#define LATENCY_THREADS 4
+#define LATENCY_ITERATIONS 1000
+#define LATENCY_OUTSTANDING 8
+
 static bool binder_selftest_run = true;
 static int binder_selftest_failures;
 static DEFINE_MUTEX(binder_selftest_lock);
@@ -271,6 +277,99 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
 	}
 }
 
+/* Mostly small transactions, with the odd large one in between. */
+static const size_t latency_sizes[] = {
+	8, 24, 64, 100, 200, 256, 1000, 3000, 3 * PAGE_SIZE,
+};
+
+struct binder_selftest_latency {
+	struct binder_alloc *alloc;
+	struct completion done;
+	int id;
+	int failures;
+	u64 total_ns;
+	u64 max_ns;
+};
+
+static int binder_selftest_latency_thread(void *data)
+{
+	struct binder_selftest_latency *lat = data;
+	struct binder_buffer *buffers[LATENCY_OUTSTANDING] = {};
+	int i;
+
+	for (i = 0; i < LATENCY_ITERATIONS; i++) {
+		int slot = i % LATENCY_OUTSTANDING;
+		size_t size = latency_sizes[(i + lat->id) %
+					    ARRAY_SIZE(latency_sizes)];
+		u64 start, ns;
+
+		if (buffers[slot])
+			binder_alloc_free_buf(lat->alloc, buffers[slot]);
+
+		start = ktime_get_ns();
+		buffers[slot] = binder_alloc_new_buf(lat->alloc, size, 0, 0, 0,
+						     0);
+		ns = ktime_get_ns() - start;
+		if (IS_ERR(buffers[slot])) {
+			buffers[slot] = NULL;
+			lat->failures++;
+			continue;
+		}
+		lat->total_ns += ns;
+		lat->max_ns = max(lat->max_ns, ns);
+	}
+
+	for (i = 0; i < LATENCY_OUTSTANDING; i++)
+		if (buffers[i])
+			binder_alloc_free_buf(lat->alloc, buffers[i]);
+
+	complete(&lat->done);
+	return 0;
+}
+
+/**
+ * binder_selftest_alloc_latency() - Measure allocation latency.
+ * @alloc: Pointer to alloc struct.
+ *
+ * Run LATENCY_THREADS threads that allocate and free a mix of small and
+ * large buffers concurrently, keeping a few of them outstanding, and
+ * report the average and worst allocation time of each thread.
+ */
+static void binder_selftest_alloc_latency(struct binder_alloc *alloc)
+{
+	struct binder_selftest_latency lat[LATENCY_THREADS];
+	struct task_struct *tsk;
+	int i;
+
+	for (i = 0; i < LATENCY_THREADS; i++) {
+		lat[i] = (struct binder_selftest_latency) {
+			.alloc = alloc,
+			.id = i,
+		};
+		init_completion(&lat[i].done);
+		tsk = kthread_run(binder_selftest_latency_thread, &lat[i],
+				  "binder_selftest/%d", i);
+		if (IS_ERR(tsk)) {
+			pr_err("failed to start latency thread %d\n", i);
+			binder_selftest_failures++;
+			complete(&lat[i].done);
+		}
+	}
+
+	for (i = 0; i < LATENCY_THREADS; i++) {
+		wait_for_completion(&lat[i].done);
+		if (lat[i].failures) {
+			pr_err("latency thread %d: %d allocations failed\n",
+			       i, lat[i].failures);
+			binder_selftest_failures++;
+		}
+		pr_info("latency thread %d: avg %llu ns max %llu ns\n", i,
+			div_u64(lat[i].total_ns, LATENCY_ITERATIONS -
+				lat[i].failures ?: 1),
+			lat[i].max_ns);
+	}
+}
+
 /**
  * binder_selftest_alloc() - Test alloc and free of buffer pages.
  * @alloc: Pointer to alloc struct.
@@ -278,7 +377,8 @@ static void binder_selftest_alloc_offset(struct binder_alloc *alloc,
  * Allocate BUFFER_NUM buffers to cover all page alignment cases,
  * then free them in all orders possible. Check that pages are
  * correctly allocated, put onto lru when buffers are freed, and
- * are freed when binder_alloc_free_page is called.
+ * are freed when binder_alloc_free_page is called. Then measure
+ * allocation latency with concurrent threads.
  */
 void binder_selftest_alloc(struct binder_alloc *alloc)
 {
@@ -290,7 +390,13 @@ void binder_selftest_alloc(struct binder_alloc *alloc)
 	if (!binder_selftest_run || !alloc->vma)
 		goto done;
 	pr_info("STARTED\n");
+	/*
+	 * The page checks expect exact buffer sizes and pages going to the
+	 * lru on free, so stay clear of the cached size classes.
+	 */
+	BUILD_BUG_ON(BUFFER_MIN_SIZE <= BINDER_ALLOC_SMALL_MAX);
 	binder_selftest_alloc_offset(alloc, end_offset, 0);
+	binder_selftest_alloc_latency(alloc);
 	binder_selftest_run = false;
 	if (binder_selftest_failures > 0)
 		pr_info("%d tests FAILED\n", binder_selftest_failures);
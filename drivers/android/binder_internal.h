@@ -139,6 +139,36 @@ struct binder_stats {
 	atomic_t obj_deleted[BINDER_STAT_COUNT];
 };
 
+#define BINDER_LATENCY_BUCKETS 20
+
+/**
+ * struct binder_latency_hist - log2 histogram of latencies
+ * @count: bucket 0 counts latencies below 1us, bucket n > 0 those in
+ *         [2^(n-1), 2^n) us; the last bucket also counts anything longer
+ *
+ * Updated under the inner_lock of the proc the histogram belongs to.
+ */
+struct binder_latency_hist {
+	u32 count[BINDER_LATENCY_BUCKETS];
+};
+
+/**
+ * struct binder_proc_latency - per-process latency histograms
+ * @queue:         time from enqueueing a transaction to a thread of the
+ *                 process dequeueing it
+ * @reply:         time from dequeueing a sync transaction to replying
+ * @lock:          time @proc->inner_lock is held
+ * @lock_start_ns: when @proc->inner_lock was last taken, 0 if not timed
+ *
+ * All fields are protected by @proc->inner_lock.
+ */
+struct binder_proc_latency {
+	struct binder_latency_hist queue;
+	struct binder_latency_hist reply;
+	struct binder_latency_hist lock;
+	u64 lock_start_ns;
+};
+
 /**
  * struct binder_work - work enqueued on a worklist
  * @entry:             node enqueued on list
@@ -269,6 +299,48 @@ struct binder_node {
 	struct list_head async_todo;
 };
 
+/**
+ * struct binder_node_latency - per-node latency histograms
+ * @queue:                enqueue to dequeue time of transactions to node
+ * @reply:                dequeue to reply time of transactions to node
+ *
+ * Protected by @proc->inner_lock of the node's proc.
+ */
+struct binder_node_latency {
+	struct binder_latency_hist queue;
+	struct binder_latency_hist reply;
+};
+
+/**
+ * struct binder_node_ext - binder node bookkeeping
+ * @node:                 the binder node
+ * @latency:              latency histograms, only allocated for nodes
+ *                        created while latency_stats is enabled
+ *                        (invariant after initialized)
+ * @async_batched:        async transactions queued ahead of the last
+ *                        buffer being freed, see binder_batch_async_ilocked()
+ *                        (protected by @node.proc->inner_lock)
+ *
+ * Extended binder_node -- needed to add the latency histograms and the
+ * async batching state without changing the KMI for binder_node.
+ */
+struct binder_node_ext {
+	struct binder_node node;
+	struct binder_node_latency *latency;
+	int async_batched;
+};
+
+static inline struct binder_node_ext *binder_node_ext(struct binder_node *node)
+{
+	return container_of(node, struct binder_node_ext, node);
+}
+
+static inline struct binder_node_latency *
+binder_node_latency(struct binder_node *node)
+{
+	return binder_node_ext(node)->latency;
+}
+
 struct binder_ref_death {
 	/**
 	 * @work: worklist element for death notifications
@@ -457,6 +529,8 @@ struct binder_proc {
  * @cred                  struct cred associated with the `struct file`
  *                        in binder_open()
  *                        (invariant after initialized)
+ * @latency:              latency histograms
+ *                        (protected by @proc->inner_lock)
  *
  * Extended binder_proc -- needed to add the "cred" field without
  * changing the KMI for binder_proc.
@@ -464,6 +538,7 @@ struct binder_proc {
 struct binder_proc_ext {
 	struct binder_proc proc;
 	const struct cred *cred;
+	struct binder_proc_latency latency;
 };
 
 static inline const struct cred *binder_get_cred(struct binder_proc *proc)
@@ -474,6 +549,12 @@ static inline const struct cred *binder_get_cred(struct binder_proc *proc)
 	return eproc->cred;
 }
 
+static inline struct binder_proc_latency *
+binder_proc_latency(struct binder_proc *proc)
+{
+	return &container_of(proc, struct binder_proc_ext, proc)->latency;
+}
+
 /**
  * struct binder_thread - binder thread bookkeeping
  * @proc:                 binder process for this thread
@@ -578,6 +659,33 @@ struct binder_transaction {
 	ANDROID_OEM_DATA_ARRAY(1, 2);
 };
 
+/**
+ * struct binder_transaction_ext - binder transaction bookkeeping
+ * @t:                    the binder transaction
+ * @enqueue_ns:           when @t was queued to the target, 0 if not timed
+ * @dequeue_ns:           when @t was picked up by a target thread
+ * @async_batched:        @t is queued to a thread by
+ *                        binder_batch_async_ilocked()
+ *                        (protected by @t->to_proc->inner_lock)
+ *
+ * Extended binder_transaction -- needed to add the timestamps for the
+ * latency histograms and the batching state without changing the KMI for
+ * binder_transaction.
+ * @t comes first so the whole allocation is released by kfree(t).
+ */
+struct binder_transaction_ext {
+	struct binder_transaction t;
+	u64 enqueue_ns;
+	u64 dequeue_ns;
+	bool async_batched;
+};
+
+static inline struct binder_transaction_ext *
+binder_txn_ext(struct binder_transaction *t)
+{
+	return container_of(t, struct binder_transaction_ext, t);
+}
+
 /**
  * struct binder_object - union of flat binder object types
  * @hdr:   generic object header
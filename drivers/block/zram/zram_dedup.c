@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Deduplication of identical compressed pages in zram
+ *
+ * Every compressed object stored while dedup is enabled gets a
+ * refcounted zram_entry, hashed by a checksum of its compressed data.
+ * Compression is deterministic, so a new page whose compressed data
+ * matches an existing entry byte for byte is identical to it and can
+ * share the zsmalloc object instead of allocating a new one.
+ */
+
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/vmalloc.h>
+#include <linux/log2.h>
+#include <linux/xxhash.h>
+
+#include "zram_drv.h"
+
+#define ZRAM_HASH_SHIFT		4
+#define ZRAM_HASH_SIZE_MIN	(1 << 10)
+#define ZRAM_HASH_SIZE_MAX	(1 << 20)
+
+u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return xxh32(mem, len, 0);
+}
+
+static struct zram_hash *zram_dedup_bucket(struct zram *zram, u32 checksum)
+{
+	return &zram->hash[checksum & (zram->hash_size - 1)];
+}
+
+/*
+ * Look up an entry whose object holds exactly @len bytes of @mem and
+ * take a reference to it. Returns NULL if there is no such entry.
+ */
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct zram_entry *entry;
+	bool match;
+	void *cmem;
+
+	spin_lock(&hash->lock);
+	hlist_for_each_entry(entry, &hash->head, node) {
+		if (entry->checksum != checksum || entry->len != len)
+			continue;
+
+		cmem = zs_map_object(zram->mem_pool, entry->handle, ZS_MM_RO);
+		match = !memcmp(mem, cmem, len);
+		zs_unmap_object(zram->mem_pool, entry->handle);
+		if (match) {
+			entry->refcount++;
+			spin_unlock(&hash->lock);
+			return entry;
+		}
+	}
+	spin_unlock(&hash->lock);
+
+	return NULL;
+}
+
+/*
+ * Create an entry owning @handle with a single reference. Returns NULL
+ * if the entry can't be allocated, in which case the caller keeps
+ * ownership of the handle and stores it without dedup.
+ */
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, checksum);
+	struct zram_entry *entry;
+
+	entry = kmalloc(sizeof(*entry), GFP_NOIO | __GFP_NOWARN);
+	if (!entry)
+		return NULL;
+
+	entry->handle = handle;
+	entry->len = len;
+	entry->checksum = checksum;
+	entry->refcount = 1;
+
+	spin_lock(&hash->lock);
+	hlist_add_head(&entry->node, &hash->head);
+	spin_unlock(&hash->lock);
+
+	return entry;
+}
+
+/*
+ * Drop a reference to @entry. Returns true if it was the last one, in
+ * which case the zsmalloc object and the entry have been freed.
+ */
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, entry->checksum);
+	unsigned long refcount;
+
+	spin_lock(&hash->lock);
+	refcount = --entry->refcount;
+	if (!refcount)
+		hlist_del(&entry->node);
+	spin_unlock(&hash->lock);
+
+	if (refcount)
+		return false;
+
+	zs_free(zram->mem_pool, entry->handle);
+	kfree(entry);
+	return true;
+}
+
+/*
+ * Whether @entry is referenced by more than one slot. Only a snapshot:
+ * a concurrent write may start sharing it right after.
+ */
+bool zram_dedup_shared(struct zram *zram, struct zram_entry *entry)
+{
+	struct zram_hash *hash = zram_dedup_bucket(zram, entry->checksum);
+	bool shared;
+
+	spin_lock(&hash->lock);
+	shared = entry->refcount > 1;
+	spin_unlock(&hash->lock);
+
+	return shared;
+}
+
+bool zram_dedup_enabled(struct zram *zram)
+{
+	return zram->hash;
+}
+
+int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	size_t i;
+
+	if (!zram->use_dedup)
+		return 0;
+
+	zram->hash_size = clamp_t(size_t, num_pages >> ZRAM_HASH_SHIFT,
+				ZRAM_HASH_SIZE_MIN, ZRAM_HASH_SIZE_MAX);
+	zram->hash_size = rounddown_pow_of_two(zram->hash_size);
+	zram->hash = vzalloc(array_size(zram->hash_size, sizeof(*zram->hash)));
+	if (!zram->hash)
+		return -ENOMEM;
+
+	for (i = 0; i < zram->hash_size; i++) {
+		spin_lock_init(&zram->hash[i].lock);
+		INIT_HLIST_HEAD(&zram->hash[i].head);
+	}
+
+	return 0;
+}
+
+void zram_dedup_fini(struct zram *zram)
+{
+	/* All slots are freed by now, so every bucket must be empty */
+	vfree(zram->hash);
+	zram->hash = NULL;
+	zram->hash_size = 0;
+}
@@ -0,0 +1,84 @@
+/* SPDX-License-Identifier: GPL-2.0-or-later */
+/*
+ * Deduplication of identical compressed pages in zram
+ */
+
+#ifndef _ZRAM_DEDUP_H_
+#define _ZRAM_DEDUP_H_
+
+#include <linux/types.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+
+struct zram;
+
+/*
+ * A compressed object which may be shared by several slots. Slots
+ * referring to an entry are tagged ZRAM_DEDUP and keep the entry
+ * pointer in their handle field.
+ */
+struct zram_entry {
+	struct hlist_node node;
+	unsigned long handle;
+	unsigned int len;
+	u32 checksum;
+	/* protected by the hash bucket lock */
+	unsigned long refcount;
+};
+
+struct zram_hash {
+	spinlock_t lock;
+	struct hlist_head head;
+};
+
+static inline unsigned long zram_entry_handle(struct zram_entry *entry)
+{
+	return entry->handle;
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+u32 zram_dedup_checksum(const void *mem, unsigned int len);
+struct zram_entry *zram_dedup_find(struct zram *zram, const void *mem,
+				unsigned int len, u32 checksum);
+struct zram_entry *zram_dedup_insert(struct zram *zram, unsigned long handle,
+				unsigned int len, u32 checksum);
+bool zram_dedup_put(struct zram *zram, struct zram_entry *entry);
+bool zram_dedup_shared(struct zram *zram, struct zram_entry *entry);
+
+bool zram_dedup_enabled(struct zram *zram);
+int zram_dedup_init(struct zram *zram, size_t num_pages);
+void zram_dedup_fini(struct zram *zram);
+#else
+static inline u32 zram_dedup_checksum(const void *mem, unsigned int len)
+{
+	return 0;
+}
+static inline struct zram_entry *zram_dedup_find(struct zram *zram,
+		const void *mem, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline struct zram_entry *zram_dedup_insert(struct zram *zram,
+		unsigned long handle, unsigned int len, u32 checksum)
+{
+	return NULL;
+}
+static inline bool zram_dedup_put(struct zram *zram, struct zram_entry *entry)
+{
+	return true;
+}
+static inline bool zram_dedup_shared(struct zram *zram,
+		struct zram_entry *entry)
+{
+	return false;
+}
+
+static inline bool zram_dedup_enabled(struct zram *zram) { return false; }
+static inline int zram_dedup_init(struct zram *zram, size_t num_pages)
+{
+	return 0;
+}
+static inline void zram_dedup_fini(struct zram *zram) { }
+#endif
+
+#endif /* _ZRAM_DEDUP_H_ */
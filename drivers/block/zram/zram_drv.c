@@ -42,6 +42,7 @@ static DEFINE_IDR(zram_index_idr);
 static DEFINE_MUTEX(zram_index_mutex);
 
 static int zram_major;
+static struct workqueue_struct *zram_comp_wq;
 static const char *default_compressor = "lzo-rle";
 
 /* Module params (documentation at end) */
@@ -114,6 +115,16 @@ static void zram_clear_flag(struct zram *zram, u32 index,
 	zram->table[index].flags &= ~BIT(flag);
 }
 
+/* zsmalloc handle of the slot's object, which may be shared by dedup */
+static unsigned long zram_get_zs_handle(struct zram *zram, u32 index)
+{
+	unsigned long handle = zram_get_handle(zram, index);
+
+	if (zram_test_flag(zram, index, ZRAM_DEDUP))
+		return zram_entry_handle((struct zram_entry *)handle);
+	return handle;
+}
+
 static inline void zram_set_element(struct zram *zram, u32 index,
 			unsigned long element)
 {
@@ -626,6 +637,312 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define HUGE_WRITEBACK 1
 #define IDLE_WRITEBACK 2
 
+#define ZRAM_WB_DEFAULT_BATCH_SIZE	32
+#define ZRAM_WB_DEFAULT_MAX_INFLIGHT	8
+#define ZRAM_WB_MAX_INFLIGHT		64
+
+struct zram_wb_slot {
+	struct page *page;
+	u32 index;
+};
+
+/*
+ * A writeback batch holds the data of up to wb_batch_size slots which are
+ * written to contiguous blocks of the backing device with a single bio.
+ */
+struct zram_wb_batch {
+	struct list_head entry;
+	struct zram_wb_ctl *ctl;
+	unsigned long blk_idx;		/* first block on backing device */
+	unsigned int nr_pages;
+	blk_status_t status;
+	ktime_t submit_time;
+	struct zram_wb_slot slots[];
+};
+
+struct zram_wb_ctl {
+	struct zram *zram;
+	unsigned int batch_size;
+	unsigned int nr_batches;
+	/* pages queued or under IO, but not completed yet */
+	unsigned long nr_pending;
+	int err;
+	struct list_head free;
+	/* done and nr_inflight are protected by done_lock */
+	spinlock_t done_lock;
+	struct list_head done;
+	atomic_t nr_inflight;
+	wait_queue_head_t wait;
+};
+
+static ssize_t writeback_batch_size_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || !val || val > BIO_MAX_PAGES)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_batch_size, val);
+	return len;
+}
+
+static ssize_t writeback_batch_size_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(zram->wb_batch_size));
+}
+
+static ssize_t writeback_max_inflight_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || !val || val > ZRAM_WB_MAX_INFLIGHT)
+		return -EINVAL;
+
+	WRITE_ONCE(zram->wb_max_inflight, val);
+	return len;
+}
+
+static ssize_t writeback_max_inflight_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(zram->wb_max_inflight));
+}
+
+static inline void update_wb_max_lat(struct zram *zram, u64 lat)
+{
+	u64 old_max, cur_max;
+
+	old_max = atomic64_read(&zram->stats.bd_wb_max_lat_us);
+
+	do {
+		cur_max = old_max;
+		if (lat > cur_max)
+			old_max = atomic64_cmpxchg(
+				&zram->stats.bd_wb_max_lat_us, cur_max, lat);
+	} while (old_max != cur_max);
+}
+
+static void zram_wb_batch_free(struct zram_wb_batch *batch,
+				unsigned int batch_size)
+{
+	unsigned int i;
+
+	for (i = 0; i < batch_size; i++) {
+		if (batch->slots[i].page)
+			__free_page(batch->slots[i].page);
+	}
+	kfree(batch);
+}
+
+static void zram_wb_ctl_destroy(struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_batch *batch, *tmp;
+
+	/* Make sure the last zram_wb_end_io is done with ctl */
+	spin_lock_irq(&ctl->done_lock);
+	spin_unlock_irq(&ctl->done_lock);
+
+	list_for_each_entry_safe(batch, tmp, &ctl->free, entry)
+		zram_wb_batch_free(batch, ctl->batch_size);
+	kfree(ctl);
+}
+
+static struct zram_wb_ctl *zram_wb_ctl_create(struct zram *zram)
+{
+	struct zram_wb_ctl *ctl;
+	unsigned int i, j, nr_batches;
+
+	ctl = kzalloc(sizeof(*ctl), GFP_KERNEL);
+	if (!ctl)
+		return NULL;
+
+	ctl->zram = zram;
+	ctl->batch_size = READ_ONCE(zram->wb_batch_size);
+	INIT_LIST_HEAD(&ctl->free);
+	INIT_LIST_HEAD(&ctl->done);
+	spin_lock_init(&ctl->done_lock);
+	atomic_set(&ctl->nr_inflight, 0);
+	init_waitqueue_head(&ctl->wait);
+
+	nr_batches = READ_ONCE(zram->wb_max_inflight);
+	for (i = 0; i < nr_batches; i++) {
+		struct zram_wb_batch *batch;
+
+		batch = kzalloc(struct_size(batch, slots, ctl->batch_size),
+				GFP_KERNEL);
+		if (!batch)
+			break;
+
+		for (j = 0; j < ctl->batch_size; j++) {
+			batch->slots[j].page = alloc_page(GFP_KERNEL);
+			if (!batch->slots[j].page)
+				break;
+		}
+
+		if (j != ctl->batch_size) {
+			zram_wb_batch_free(batch, ctl->batch_size);
+			break;
+		}
+
+		batch->ctl = ctl;
+		list_add(&batch->entry, &ctl->free);
+		ctl->nr_batches++;
+	}
+
+	/* Run with fewer bios in flight rather than fail under pressure */
+	if (!ctl->nr_batches) {
+		kfree(ctl);
+		return NULL;
+	}
+
+	return ctl;
+}
+
+static void zram_wb_end_io(struct bio *bio)
+{
+	struct zram_wb_batch *batch = bio->bi_private;
+	struct zram_wb_ctl *ctl = batch->ctl;
+	struct zram *zram = ctl->zram;
+	unsigned long flags;
+	u64 lat;
+
+	lat = ktime_us_delta(ktime_get(), batch->submit_time);
+	atomic64_add(lat, &zram->stats.bd_wb_lat_us);
+	update_wb_max_lat(zram, lat);
+
+	batch->status = bio->bi_status;
+	bio_put(bio);
+
+	spin_lock_irqsave(&ctl->done_lock, flags);
+	list_add_tail(&batch->entry, &ctl->done);
+	atomic_dec(&ctl->nr_inflight);
+	wake_up(&ctl->wait);
+	spin_unlock_irqrestore(&ctl->done_lock, flags);
+}
+
+static void zram_wb_submit_batch(struct zram_wb_ctl *ctl,
+				struct zram_wb_batch *batch)
+{
+	struct zram *zram = ctl->zram;
+	struct bio *bio;
+	unsigned int i;
+
+	bio = bio_alloc(GFP_NOIO, batch->nr_pages);
+	bio_set_dev(bio, zram->bdev);
+	bio->bi_iter.bi_sector = batch->blk_idx * (PAGE_SIZE >> 9);
+	bio->bi_opf = REQ_OP_WRITE | REQ_SYNC;
+	bio->bi_private = batch;
+	bio->bi_end_io = zram_wb_end_io;
+
+	for (i = 0; i < batch->nr_pages; i++)
+		bio_add_page(bio, batch->slots[i].page, PAGE_SIZE, 0);
+
+	atomic_inc(&ctl->nr_inflight);
+	atomic64_inc(&zram->stats.bd_wb_bios);
+	batch->submit_time = ktime_get();
+	submit_bio(bio);
+}
+
+static void zram_wb_complete_slot(struct zram *zram, u32 index,
+				unsigned long blk_idx, blk_status_t status)
+{
+	zram_slot_lock(zram, index);
+	if (status) {
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		free_block_bdev(zram, blk_idx);
+		goto out;
+	}
+
+	atomic64_inc(&zram->stats.bd_writes);
+	/*
+	 * We released zram_slot_lock so need to check if the slot was
+	 * changed. If there is freeing for the slot, we can catch it
+	 * easily by zram_allocated.
+	 * A subtle case is the slot is freed/reallocated/marked as
+	 * ZRAM_IDLE again. To close the race, idle_store doesn't
+	 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
+	 * Thus, we could close the race by checking ZRAM_IDLE bit.
+	 */
+	if (!zram_allocated(zram, index) ||
+		  !zram_test_flag(zram, index, ZRAM_IDLE)) {
+		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+		zram_clear_flag(zram, index, ZRAM_IDLE);
+		free_block_bdev(zram, blk_idx);
+		goto out;
+	}
+
+	zram_free_page(zram, index);
+	zram_clear_flag(zram, index, ZRAM_UNDER_WB);
+	zram_set_flag(zram, index, ZRAM_WB);
+	zram_set_element(zram, index, blk_idx);
+	atomic64_inc(&zram->stats.pages_stored);
+	spin_lock(&zram->wb_limit_lock);
+	if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
+		zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
+	spin_unlock(&zram->wb_limit_lock);
+out:
+	zram_slot_unlock(zram, index);
+}
+
+/*
+ * Finish the slots of every completed batch and return the batches to
+ * the free list. Must be called from the context which owns ctl.
+ */
+static void zram_wb_complete(struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_batch *batch, *tmp;
+	LIST_HEAD(done);
+	unsigned int i;
+
+	spin_lock_irq(&ctl->done_lock);
+	list_splice_init(&ctl->done, &done);
+	spin_unlock_irq(&ctl->done_lock);
+
+	list_for_each_entry_safe(batch, tmp, &done, entry) {
+		for (i = 0; i < batch->nr_pages; i++)
+			zram_wb_complete_slot(ctl->zram,
+					batch->slots[i].index,
+					batch->blk_idx + i, batch->status);
+
+		/*
+		 * Return last IO error unless every IO were
+		 * not suceeded.
+		 */
+		if (batch->status)
+			ctl->err = blk_status_to_errno(batch->status);
+		ctl->nr_pending -= batch->nr_pages;
+		batch->nr_pages = 0;
+		batch->status = BLK_STS_OK;
+		list_move(&batch->entry, &ctl->free);
+	}
+}
+
+static struct zram_wb_batch *zram_wb_get_batch(struct zram_wb_ctl *ctl)
+{
+	struct zram_wb_batch *batch;
+
+	if (list_empty(&ctl->free)) {
+		wait_event(ctl->wait,
+			atomic_read(&ctl->nr_inflight) < ctl->nr_batches);
+		zram_wb_complete(ctl);
+	}
+
+	batch = list_first_entry(&ctl->free, struct zram_wb_batch, entry);
+	list_del(&batch->entry);
+	return batch;
+}
 
 static ssize_t writeback_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
@@ -633,12 +950,12 @@ static ssize_t writeback_store(struct device *dev,
 	struct zram *zram = dev_to_zram(dev);
 	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
 	unsigned long index = 0;
-	struct bio bio;
-	struct bio_vec bio_vec;
-	struct page *page;
+	struct zram_wb_ctl *ctl;
+	struct zram_wb_batch *batch = NULL;
 	ssize_t ret = len;
-	int mode, err;
+	int mode;
 	unsigned long blk_idx = 0;
+	ktime_t start;
 
 	if (sysfs_streq(buf, "idle"))
 		mode = IDLE_WRITEBACK;
@@ -667,21 +984,23 @@ static ssize_t writeback_store(struct device *dev,
 		goto release_init_lock;
 	}
 
-	page = alloc_page(GFP_KERNEL);
-	if (!page) {
+	ctl = zram_wb_ctl_create(zram);
+	if (!ctl) {
 		ret = -ENOMEM;
 		goto release_init_lock;
 	}
 
+	start = ktime_get();
 	for (; nr_pages != 0; index++, nr_pages--) {
 		struct bio_vec bvec;
 
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
-
+		/*
+		 * Pages still under IO have not been charged to
+		 * bd_wb_limit yet, so count them against it here.
+		 */
 		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && !zram->bd_wb_limit) {
+		if (zram->wb_limit_enable && zram->bd_wb_limit <=
+				ctl->nr_pending << (PAGE_SHIFT - 12)) {
 			spin_unlock(&zram->wb_limit_lock);
 			ret = -EIO;
 			break;
@@ -719,74 +1038,59 @@ static ssize_t writeback_store(struct device *dev,
 		/* Need for hugepage writeback racing */
 		zram_set_flag(zram, index, ZRAM_IDLE);
 		zram_slot_unlock(zram, index);
-		if (zram_bvec_read(zram, &bvec, index, 0, NULL)) {
-			zram_slot_lock(zram, index);
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			zram_slot_unlock(zram, index);
-			continue;
+
+		/* A bio can only cover contiguous blocks of backing device */
+		if (batch && batch->nr_pages &&
+				blk_idx != batch->blk_idx + batch->nr_pages) {
+			zram_wb_submit_batch(ctl, batch);
+			batch = NULL;
 		}
 
-		bio_init(&bio, &bio_vec, 1);
-		bio_set_dev(&bio, zram->bdev);
-		bio.bi_iter.bi_sector = blk_idx * (PAGE_SIZE >> 9);
-		bio.bi_opf = REQ_OP_WRITE | REQ_SYNC;
+		if (!batch)
+			batch = zram_wb_get_batch(ctl);
 
-		bio_add_page(&bio, bvec.bv_page, bvec.bv_len,
-				bvec.bv_offset);
-		/*
-		 * XXX: A single page IO would be inefficient for write
-		 * but it would be not bad as starter.
-		 */
-		err = submit_bio_wait(&bio);
-		if (err) {
+		bvec.bv_page = batch->slots[batch->nr_pages].page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+
+		if (zram_bvec_read(zram, &bvec, index, 0, NULL)) {
 			zram_slot_lock(zram, index);
 			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
 			zram_clear_flag(zram, index, ZRAM_IDLE);
 			zram_slot_unlock(zram, index);
-			/*
-			 * Return last IO error unless every IO were
-			 * not suceeded.
-			 */
-			ret = err;
 			continue;
 		}
 
-		atomic64_inc(&zram->stats.bd_writes);
-		/*
-		 * We released zram_slot_lock so need to check if the slot was
-		 * changed. If there is freeing for the slot, we can catch it
-		 * easily by zram_allocated.
-		 * A subtle case is the slot is freed/reallocated/marked as
-		 * ZRAM_IDLE again. To close the race, idle_store doesn't
-		 * mark ZRAM_IDLE once it found the slot was ZRAM_UNDER_WB.
-		 * Thus, we could close the race by checking ZRAM_IDLE bit.
-		 */
-		zram_slot_lock(zram, index);
-		if (!zram_allocated(zram, index) ||
-			  !zram_test_flag(zram, index, ZRAM_IDLE)) {
-			zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-			zram_clear_flag(zram, index, ZRAM_IDLE);
-			goto next;
-		}
-
-		zram_free_page(zram, index);
-		zram_clear_flag(zram, index, ZRAM_UNDER_WB);
-		zram_set_flag(zram, index, ZRAM_WB);
-		zram_set_element(zram, index, blk_idx);
+		if (!batch->nr_pages)
+			batch->blk_idx = blk_idx;
+		batch->slots[batch->nr_pages++].index = index;
+		ctl->nr_pending++;
 		blk_idx = 0;
-		atomic64_inc(&zram->stats.pages_stored);
-		spin_lock(&zram->wb_limit_lock);
-		if (zram->wb_limit_enable && zram->bd_wb_limit > 0)
-			zram->bd_wb_limit -=  1UL << (PAGE_SHIFT - 12);
-		spin_unlock(&zram->wb_limit_lock);
+
+		if (batch->nr_pages == ctl->batch_size) {
+			zram_wb_submit_batch(ctl, batch);
+			batch = NULL;
+		}
+		continue;
 next:
 		zram_slot_unlock(zram, index);
 	}
 
+	if (batch && batch->nr_pages)
+		zram_wb_submit_batch(ctl, batch);
+	else if (batch)
+		list_add(&batch->entry, &ctl->free);
+
+	wait_event(ctl->wait, !atomic_read(&ctl->nr_inflight));
+	zram_wb_complete(ctl);
+	atomic64_add(ktime_us_delta(ktime_get(), start),
+			&zram->stats.bd_wb_time_us);
+
+	if (ctl->err && ret == len)
+		ret = ctl->err;
 	if (blk_idx)
 		free_block_bdev(zram, blk_idx);
-	__free_page(page);
+	zram_wb_ctl_destroy(ctl);
 release_init_lock:
 	up_read(&zram->init_lock);
 
@@ -992,6 +1296,28 @@ static ssize_t max_comp_streams_store(struct device *dev,
 	return len;
 }
 
+static ssize_t max_comp_fanout_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	struct zram *zram = dev_to_zram(dev);
+
+	return scnprintf(buf, PAGE_SIZE, "%u\n",
+			READ_ONCE(zram->max_comp_fanout));
+}
+
+static ssize_t max_comp_fanout_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned int val;
+
+	if (kstrtouint(buf, 10, &val) || !val || val > num_possible_cpus())
+		return -EINVAL;
+
+	WRITE_ONCE(zram->max_comp_fanout, val);
+	return len;
+}
+
 static ssize_t comp_algorithm_show(struct device *dev,
 		struct device_attribute *attr, char *buf)
 {
@@ -1033,6 +1359,84 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recompressor, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recompressor)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recompressor, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
+static ssize_t use_dedup_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	val = zram->use_dedup;
+	up_read(&zram->init_lock);
+
+	return scnprintf(buf, PAGE_SIZE, "%d\n", val);
+}
+
+#ifdef CONFIG_ZRAM_DEDUP
+static ssize_t use_dedup_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	bool val;
+	struct zram *zram = dev_to_zram(dev);
+
+	if (kstrtobool(buf, &val))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change dedup usage for initialized device\n");
+		return -EBUSY;
+	}
+	zram->use_dedup = val;
+	up_write(&zram->init_lock);
+	return len;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1089,7 +1493,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -1097,7 +1501,10 @@ static ssize_t mm_stat_show(struct device *dev,
 			max_used << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			atomic_long_read(&pool_stats.pages_compacted),
-			(u64)atomic64_read(&zram->stats.huge_pages));
+			(u64)atomic64_read(&zram->stats.huge_pages),
+			(u64)atomic64_read(&zram->stats.recomp_pages),
+			(u64)atomic64_read(&zram->stats.dup_data_size),
+			(u64)atomic64_read(&zram->stats.dedup_hits));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1113,10 +1520,14 @@ static ssize_t bd_stat_show(struct device *dev,
 
 	down_read(&zram->init_lock);
 	ret = scnprintf(buf, PAGE_SIZE,
-		"%8llu %8llu %8llu\n",
+		"%8llu %8llu %8llu %8llu %8llu %8llu %8llu\n",
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_count)),
 			FOUR_K((u64)atomic64_read(&zram->stats.bd_reads)),
-			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)));
+			FOUR_K((u64)atomic64_read(&zram->stats.bd_writes)),
+			(u64)atomic64_read(&zram->stats.bd_wb_bios),
+			(u64)atomic64_read(&zram->stats.bd_wb_time_us),
+			(u64)atomic64_read(&zram->stats.bd_wb_lat_us),
+			(u64)atomic64_read(&zram->stats.bd_wb_max_lat_us));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1157,6 +1568,7 @@ static void zram_meta_free(struct zram *zram, u64 disksize)
 	for (index = 0; index < num_pages; index++)
 		zram_free_page(zram, index);
 
+	zram_dedup_fini(zram);
 	zs_destroy_pool(zram->mem_pool);
 	vfree(zram->table);
 }
@@ -1176,6 +1588,12 @@ static bool zram_meta_alloc(struct zram *zram, u64 disksize)
 		return false;
 	}
 
+	if (zram_dedup_init(zram, num_pages)) {
+		zs_destroy_pool(zram->mem_pool);
+		vfree(zram->table);
+		return false;
+	}
+
 	if (!huge_class_size)
 		huge_class_size = zs_huge_class_size(zram->mem_pool);
 	return true;
@@ -1196,6 +1614,9 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
 		atomic64_dec(&zram->stats.huge_pages);
@@ -1221,6 +1642,21 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (!handle)
 		return;
 
+	/*
+	 * The last slot dropping a shared object accounts it as compressed
+	 * data, the others only account their duplicate.
+	 */
+	if (zram_test_flag(zram, index, ZRAM_DEDUP)) {
+		zram_clear_flag(zram, index, ZRAM_DEDUP);
+		if (zram_dedup_put(zram, (struct zram_entry *)handle))
+			atomic64_sub(zram_get_obj_size(zram, index),
+					&zram->stats.compr_data_size);
+		else
+			atomic64_sub(zram_get_obj_size(zram, index),
+					&zram->stats.dup_data_size);
+		goto out;
+	}
+
 	zs_free(zram->mem_pool, handle);
 
 	atomic64_sub(zram_get_obj_size(zram, index),
@@ -1233,29 +1669,29 @@ static void zram_free_page(struct zram *zram, size_t index)
 		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
 }
 
-static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
-				struct bio *bio, bool partial_io)
+static struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
+/*
+ * Decompress the slot's object into @page.
+ * The caller must hold the slot lock and the slot must not be ZRAM_WB.
+ */
+static int zram_read_from_zspool(struct zram *zram, struct page *page,
+				u32 index)
 {
 	struct zcomp_strm *zstrm;
+	struct zcomp *comp;
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
 	int ret;
 
-	zram_slot_lock(zram, index);
-	if (zram_test_flag(zram, index, ZRAM_WB)) {
-		struct bio_vec bvec;
-
-		zram_slot_unlock(zram, index);
-
-		bvec.bv_page = page;
-		bvec.bv_len = PAGE_SIZE;
-		bvec.bv_offset = 0;
-		return read_from_bdev(zram, &bvec,
-				zram_get_element(zram, index),
-				bio, partial_io);
-	}
-
 	handle = zram_get_handle(zram, index);
 	if (!handle || zram_test_flag(zram, index, ZRAM_SAME)) {
 		unsigned long value;
@@ -1265,14 +1701,15 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		mem = kmap_atomic(page);
 		zram_fill_page(mem, PAGE_SIZE, value);
 		kunmap_atomic(mem);
-		zram_slot_unlock(zram, index);
 		return 0;
 	}
 
+	handle = zram_get_zs_handle(zram, index);
 	size = zram_get_obj_size(zram, index);
+	comp = zram_slot_comp(zram, index);
 
 	if (size != PAGE_SIZE)
-		zstrm = zcomp_stream_get(zram->comp);
+		zstrm = zcomp_stream_get(comp);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1284,9 +1721,33 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
+
+	return ret;
+}
+
+static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
+				struct bio *bio, bool partial_io)
+{
+	int ret;
+
+	zram_slot_lock(zram, index);
+	if (zram_test_flag(zram, index, ZRAM_WB)) {
+		struct bio_vec bvec;
+
+		zram_slot_unlock(zram, index);
+
+		bvec.bv_page = page;
+		bvec.bv_len = PAGE_SIZE;
+		bvec.bv_offset = 0;
+		return read_from_bdev(zram, &bvec,
+				zram_get_element(zram, index),
+				bio, partial_io);
+	}
+
+	ret = zram_read_from_zspool(zram, page, index);
 	zram_slot_unlock(zram, index);
 
 	/* Should NEVER happen. Return bio error if it does. */
@@ -1341,6 +1802,8 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	struct page *page = bvec->bv_page;
 	unsigned long element = 0;
 	enum zram_pageflags flags = 0;
+	struct zram_entry *entry = NULL;
+	u32 checksum = 0;
 
 	mem = kmap_atomic(page);
 	if (page_same_filled(mem, &element)) {
@@ -1367,6 +1830,28 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 
 	if (comp_len >= huge_class_size)
 		comp_len = PAGE_SIZE;
+
+	if (zram_dedup_enabled(zram)) {
+		src = zstrm->buffer;
+		if (comp_len == PAGE_SIZE)
+			src = kmap_atomic(page);
+		checksum = zram_dedup_checksum(src, comp_len);
+		entry = zram_dedup_find(zram, src, comp_len, checksum);
+		if (comp_len == PAGE_SIZE)
+			kunmap_atomic(src);
+
+		if (entry) {
+			zcomp_stream_put(zram->comp);
+			/* handle may come from the slow path below */
+			if (handle)
+				zs_free(zram->mem_pool, handle);
+			flags = ZRAM_DEDUP;
+			atomic64_add(comp_len, &zram->stats.dup_data_size);
+			atomic64_inc(&zram->stats.dedup_hits);
+			goto out;
+		}
+	}
+
 	/*
 	 * handle allocation has 2 paths:
 	 * a) fast path is executed with preemption disabled (for
@@ -1419,6 +1904,12 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	zcomp_stream_put(zram->comp);
 	zs_unmap_object(zram->mem_pool, handle);
 	atomic64_add(comp_len, &zram->stats.compr_data_size);
+
+	if (zram_dedup_enabled(zram)) {
+		entry = zram_dedup_insert(zram, handle, comp_len, checksum);
+		if (entry)
+			flags = ZRAM_DEDUP;
+	}
 out:
 	/*
 	 * Free memory associated with this sector
@@ -1432,10 +1923,14 @@ static int __zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 		atomic64_inc(&zram->stats.huge_pages);
 	}
 
-	if (flags) {
+	if (flags == ZRAM_SAME) {
 		zram_set_flag(zram, index, flags);
 		zram_set_element(zram, index, element);
-	}  else {
+	} else if (flags == ZRAM_DEDUP) {
+		zram_set_flag(zram, index, flags);
+		zram_set_handle(zram, index, (unsigned long)entry);
+		zram_set_obj_size(zram, index, comp_len);
+	} else {
 		zram_set_handle(zram, index, handle);
 		zram_set_obj_size(zram, index, comp_len);
 	}
@@ -1487,6 +1982,157 @@ static int zram_bvec_write(struct zram *zram, struct bio_vec *bvec,
 	return ret;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+#define RECOMPRESS_IDLE	0
+#define RECOMPRESS_HUGE	1
+
+/*
+ * Recompress the slot's object with the secondary algorithm and replace
+ * it if the result is smaller. The caller must hold the slot lock, so
+ * the new object is allocated without direct reclaim.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	struct zcomp_strm *zstrm;
+	unsigned long handle_new;
+	unsigned int comp_len_old, comp_len_new;
+	bool idle;
+	void *src, *dst;
+	int ret;
+
+	if (!zram_get_handle(zram, index))
+		return 0;
+
+	comp_len_old = zram_get_obj_size(zram, index);
+	ret = zram_read_from_zspool(zram, page, index);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &comp_len_new);
+	kunmap_atomic(src);
+
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	/* Keep the old object unless the secondary algorithm shrinks it */
+	if (comp_len_new >= huge_class_size || comp_len_new >= comp_len_old) {
+		zcomp_stream_put(zram->recomp);
+		return 0;
+	}
+
+	handle_new = zs_malloc(zram->mem_pool, comp_len_new,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE |
+			__GFP_CMA);
+	if (!handle_new) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle_new, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, comp_len_new);
+	zcomp_stream_put(zram->recomp);
+	zs_unmap_object(zram->mem_pool, handle_new);
+
+	/* zram_free_page clears ZRAM_IDLE, which writeback still needs */
+	idle = zram_test_flag(zram, index, ZRAM_IDLE);
+	zram_free_page(zram, index);
+	zram_set_handle(zram, index, handle_new);
+	zram_set_obj_size(zram, index, comp_len_new);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	if (idle)
+		zram_set_flag(zram, index, ZRAM_IDLE);
+
+	atomic64_add(comp_len_new, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_inc(&zram->stats.recomp_pages);
+	return 0;
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	struct page *page;
+	ssize_t ret = len;
+	int mode, err;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = RECOMPRESS_IDLE;
+	else if (sysfs_streq(buf, "huge"))
+		mode = RECOMPRESS_HUGE;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		err = 0;
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP))
+			goto next;
+
+		/*
+		 * Replacing a shared object would only add a copy. One used
+		 * by this slot alone is dropped from dedup when replaced, as
+		 * its recompressed data can't match a new write anyway.
+		 */
+		if (zram_test_flag(zram, index, ZRAM_DEDUP) &&
+				zram_dedup_shared(zram,
+				(struct zram_entry *)zram_get_handle(zram, index)))
+			goto next;
+
+		if (mode == RECOMPRESS_IDLE &&
+			  !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+		if (mode == RECOMPRESS_HUGE &&
+			  !zram_test_flag(zram, index, ZRAM_HUGE))
+			goto next;
+
+		err = zram_recompress(zram, index, page);
+next:
+		zram_slot_unlock(zram, index);
+		if (err) {
+			ret = err;
+			break;
+		}
+
+		cond_resched();
+	}
+
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 /*
  * zram_bio_discard - handler on discard request
  * @index: physical block index in PAGE_SIZE units
@@ -1558,30 +2204,19 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
-static void __zram_make_request(struct zram *zram, struct bio *bio)
+static void zram_bio_rw(struct zram *zram, struct bio *bio,
+			struct bvec_iter start)
 {
 	int offset;
 	u32 index;
 	struct bio_vec bvec;
 	struct bvec_iter iter;
-	unsigned long start_time;
 
-	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
-	offset = (bio->bi_iter.bi_sector &
+	index = start.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	offset = (start.bi_sector &
 		  (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
 
-	switch (bio_op(bio)) {
-	case REQ_OP_DISCARD:
-	case REQ_OP_WRITE_ZEROES:
-		zram_bio_discard(zram, index, offset, bio);
-		bio_endio(bio);
-		return;
-	default:
-		break;
-	}
-
-	start_time = bio_start_io_acct(bio);
-	bio_for_each_segment(bvec, bio, iter) {
+	__bio_for_each_segment(bvec, bio, iter, start) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
 
@@ -1600,6 +2235,133 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 			update_position(&index, &offset, &bv);
 		} while (unwritten);
 	}
+}
+
+struct zram_fanout;
+
+struct zram_fanout_work {
+	struct work_struct work;
+	struct zram_fanout *fo;
+	/* the part of the bio handled by this work */
+	struct bvec_iter iter;
+};
+
+/*
+ * A write bio whose pages are compressed in parallel. Each work uses the
+ * per-cpu stream of the CPU it runs on and the last one to finish ends
+ * the bio.
+ */
+struct zram_fanout {
+	struct zram *zram;
+	struct bio *bio;
+	unsigned long start_time;
+	atomic_t remaining;
+	struct zram_fanout_work works[];
+};
+
+static void zram_fanout_run(struct zram_fanout_work *fw)
+{
+	struct zram_fanout *fo = fw->fo;
+
+	zram_bio_rw(fo->zram, fo->bio, fw->iter);
+
+	if (atomic_dec_and_test(&fo->remaining)) {
+		bio_end_io_acct(fo->bio, fo->start_time);
+		bio_endio(fo->bio);
+		kfree(fo);
+	}
+}
+
+static void zram_fanout_work_fn(struct work_struct *work)
+{
+	zram_fanout_run(container_of(work, struct zram_fanout_work, work));
+}
+
+/*
+ * Split a write bio into up to max_comp_fanout parts and compress them on
+ * different CPUs. The submitter handles the first part itself. Returns
+ * false if the bio should be handled serially by the caller.
+ */
+static bool zram_fanout_write(struct zram *zram, struct bio *bio,
+			unsigned long start_time)
+{
+	struct bvec_iter iter = bio->bi_iter;
+	unsigned int nr_pages = iter.bi_size >> PAGE_SHIFT;
+	unsigned int fanout, chunk, i;
+	struct zram_fanout *fo;
+	int cpu;
+
+	fanout = min3(READ_ONCE(zram->max_comp_fanout), nr_pages,
+			num_online_cpus());
+	if (fanout < 2)
+		return false;
+
+	/* Two works must never share a slot */
+	if ((iter.bi_sector & (SECTORS_PER_PAGE - 1)) ||
+			(iter.bi_size & ~PAGE_MASK))
+		return false;
+
+	chunk = DIV_ROUND_UP(nr_pages, fanout);
+	fanout = DIV_ROUND_UP(nr_pages, chunk);
+
+	fo = kmalloc(struct_size(fo, works, fanout), GFP_NOIO | __GFP_NOWARN);
+	if (!fo)
+		return false;
+
+	fo->zram = zram;
+	fo->bio = bio;
+	fo->start_time = start_time;
+	atomic_set(&fo->remaining, fanout);
+
+	for (i = 0; i < fanout; i++) {
+		struct zram_fanout_work *fw = &fo->works[i];
+
+		fw->fo = fo;
+		fw->iter = iter;
+		fw->iter.bi_size = min_t(unsigned int, chunk << PAGE_SHIFT,
+					iter.bi_size);
+		bio_advance_iter(bio, &iter, fw->iter.bi_size);
+		INIT_WORK(&fw->work, zram_fanout_work_fn);
+	}
+
+	cpu = raw_smp_processor_id();
+	for (i = 1; i < fanout; i++) {
+		cpu = cpumask_next(cpu, cpu_online_mask);
+		if (cpu >= nr_cpu_ids)
+			cpu = cpumask_first(cpu_online_mask);
+		queue_work_on(cpu, zram_comp_wq, &fo->works[i].work);
+	}
+
+	zram_fanout_run(&fo->works[0]);
+	return true;
+}
+
+static void __zram_make_request(struct zram *zram, struct bio *bio)
+{
+	int offset;
+	u32 index;
+	unsigned long start_time;
+
+	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	offset = (bio->bi_iter.bi_sector &
+		  (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
+
+	switch (bio_op(bio)) {
+	case REQ_OP_DISCARD:
+	case REQ_OP_WRITE_ZEROES:
+		zram_bio_discard(zram, index, offset, bio);
+		bio_endio(bio);
+		return;
+	default:
+		break;
+	}
+
+	start_time = bio_start_io_acct(bio);
+	if (op_is_write(bio_op(bio)) &&
+			zram_fanout_write(zram, bio, start_time))
+		return;
+
+	zram_bio_rw(zram, bio, bio->bi_iter);
 	bio_end_io_acct(bio, start_time);
 	bio_endio(bio);
 }
@@ -1699,6 +2461,9 @@ static int zram_rw_page(struct block_device *bdev, sector_t sector,
 static void zram_reset_device(struct zram *zram)
 {
 	struct zcomp *comp;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	struct zcomp *recomp;
+#endif
 	u64 disksize;
 
 	down_write(&zram->init_lock);
@@ -1713,15 +2478,24 @@ static void zram_reset_device(struct zram *zram)
 	comp = zram->comp;
 	disksize = zram->disksize;
 	zram->disksize = 0;
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	recomp = zram->recomp;
+	zram->recomp = NULL;
+#endif
 
 	set_capacity(zram->disk, 0);
 	part_stat_set_all(&zram->disk->part0, 0);
 
 	up_write(&zram->init_lock);
 	/* I/O operation under all of CPU are done so let's free */
+	flush_workqueue(zram_comp_wq);
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (recomp)
+		zcomp_destroy(recomp);
+#endif
 	reset_bdev(zram);
 }
 
@@ -1758,6 +2532,21 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recompressor[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recompressor);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s recompressing backend\n",
+					zram->recompressor);
+			err = PTR_ERR(recomp);
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+		zram->recomp = recomp;
+	}
+#endif
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1857,12 +2646,24 @@ static DEVICE_ATTR_WO(mem_limit);
 static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
+static DEVICE_ATTR_RW(max_comp_fanout);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_DEDUP
+static DEVICE_ATTR_RW(use_dedup);
+#else
+static DEVICE_ATTR_RO(use_dedup);
+#endif
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
 static DEVICE_ATTR_RW(writeback_limit);
 static DEVICE_ATTR_RW(writeback_limit_enable);
+static DEVICE_ATTR_RW(writeback_batch_size);
+static DEVICE_ATTR_RW(writeback_max_inflight);
 #endif
 
 static struct attribute *zram_disk_attrs[] = {
@@ -1874,12 +2675,20 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_mem_used_max.attr,
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
+	&dev_attr_max_comp_fanout.attr,
 	&dev_attr_comp_algorithm.attr,
+	&dev_attr_use_dedup.attr,
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
 	&dev_attr_writeback_limit.attr,
 	&dev_attr_writeback_limit_enable.attr,
+	&dev_attr_writeback_batch_size.attr,
+	&dev_attr_writeback_max_inflight.attr,
 #endif
 	&dev_attr_io_stat.attr,
 	&dev_attr_mm_stat.attr,
@@ -1919,8 +2728,11 @@ static int zram_add(void)
 	device_id = ret;
 
 	init_rwsem(&zram->init_lock);
+	zram->max_comp_fanout = 1;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spin_lock_init(&zram->wb_limit_lock);
+	zram->wb_batch_size = ZRAM_WB_DEFAULT_BATCH_SIZE;
+	zram->wb_max_inflight = ZRAM_WB_DEFAULT_MAX_INFLIGHT;
 #endif
 	queue = blk_alloc_queue(NUMA_NO_NODE);
 	if (!queue) {
@@ -2110,6 +2922,7 @@ static void destroy_devices(void)
 	zram_debugfs_destroy();
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
+	destroy_workqueue(zram_comp_wq);
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 }
 
@@ -2117,14 +2930,24 @@ static int __init zram_init(void)
 {
 	int ret;
 
+	BUILD_BUG_ON(__NR_ZRAM_PAGEFLAGS > BITS_PER_LONG);
+
 	ret = cpuhp_setup_state_multi(CPUHP_ZCOMP_PREPARE, "block/zram:prepare",
 				      zcomp_cpu_up_prepare, zcomp_cpu_dead);
 	if (ret < 0)
 		return ret;
 
+	zram_comp_wq = alloc_workqueue("zram_comp",
+				WQ_HIGHPRI | WQ_MEM_RECLAIM, 0);
+	if (!zram_comp_wq) {
+		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		return -ENOMEM;
+	}
+
 	ret = class_register(&zram_control_class);
 	if (ret) {
 		pr_err("Unable to register zram-control class\n");
+		destroy_workqueue(zram_comp_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return ret;
 	}
@@ -2134,6 +2957,7 @@ static int __init zram_init(void)
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
+		destroy_workqueue(zram_comp_wq);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
 		return -EBUSY;
 	}
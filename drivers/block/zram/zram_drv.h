@@ -20,6 +20,7 @@
 #include <linux/crypto.h>
 
 #include "zcomp.h"
+#include "zram_dedup.h"
 
 #define SECTORS_PER_PAGE_SHIFT	(PAGE_SHIFT - SECTOR_SHIFT)
 #define SECTORS_PER_PAGE	(1 << SECTORS_PER_PAGE_SHIFT)
@@ -50,6 +51,8 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page was recompressed with the secondary algorithm */
+	ZRAM_DEDUP,	/* handle points to a shared zram_entry */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -82,10 +85,17 @@ struct zram_stats {
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t writestall;		/* no. of write slow paths */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t recomp_pages;	/* no. of pages recompressed */
+	atomic64_t dup_data_size;	/* compressed size of deduped pages */
+	atomic64_t dedup_hits;		/* no. of pages deduped on write */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
 	atomic64_t bd_writes;		/* no. of writes from backing device */
+	atomic64_t bd_wb_bios;		/* no. of writeback bios submitted */
+	atomic64_t bd_wb_time_us;	/* time spent in writeback passes */
+	atomic64_t bd_wb_lat_us;	/* sum of writeback bio latencies */
+	atomic64_t bd_wb_max_lat_us;	/* max writeback bio latency */
 #endif
 };
 
@@ -107,16 +117,31 @@ struct zram {
 	 * we can store in a disk.
 	 */
 	u64 disksize;	/* bytes */
+	/* max number of CPUs compressing the pages of one write bio */
+	unsigned int max_comp_fanout;
 	char compressor[CRYPTO_MAX_ALG_NAME];
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	/* secondary algorithm used by recompression, if any */
+	struct zcomp *recomp;
+	char recompressor[CRYPTO_MAX_ALG_NAME];
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
 	bool claim; /* Protected by bdev->bd_mutex */
+	bool use_dedup;
+#ifdef CONFIG_ZRAM_DEDUP
+	struct zram_hash *hash;
+	size_t hash_size;
+#endif
 	struct file *backing_dev;
 #ifdef CONFIG_ZRAM_WRITEBACK
 	spinlock_t wb_limit_lock;
 	bool wb_limit_enable;
 	u64 bd_wb_limit;
+	/* max pages per writeback bio and max bios in flight */
+	unsigned int wb_batch_size;
+	unsigned int wb_max_inflight;
 	struct block_device *bdev;
 	unsigned int old_block_size;
 	unsigned long *bitmap;
@@ -16,6 +16,8 @@
 #include <linux/magic.h>
 #include <linux/slab.h>
 #include <linux/vmalloc.h>
+#include <linux/kobject.h>
+#include <linux/completion.h>
 #include "erofs_fs.h"
 
 /* redefine pr_fmt "erofs: " */
@@ -67,6 +69,18 @@ struct erofs_sb_lz4_info {
 	u16 max_pclusterblks;
 };
 
+#ifdef CONFIG_EROFS_FS_ZIP
+/* cache of decompressed data for hot pclusters, see zcache.c */
+struct z_erofs_dcache {
+	/* entries indexed by the physical block of their pcluster */
+	struct xarray entries;
+	/* protected by the xa_lock of entries */
+	struct list_head lru;
+	unsigned long size, limit;	/* in bytes, disabled if limit is 0 */
+	u64 hits, misses, evictions;
+};
+#endif
+
 struct erofs_sb_info {
 #ifdef CONFIG_EROFS_FS_ZIP
 	/* list for all registered superblocks, mainly for shrinker */
@@ -83,6 +97,8 @@ struct erofs_sb_info {
 	struct inode *managed_cache;
 
 	struct erofs_sb_lz4_info lz4;
+
+	struct z_erofs_dcache dcache;
 #endif	/* CONFIG_EROFS_FS_ZIP */
 	u32 blocks;
 	u32 meta_blkaddr;
@@ -108,6 +124,10 @@ struct erofs_sb_info {
 	u32 feature_incompat;
 
 	struct erofs_fs_context ctx;	/* options */
+
+	/* sysfs support */
+	struct kobject s_kobj;		/* /sys/fs/erofs/<devname> */
+	struct completion s_kobj_unregister;
 };
 
 #define EROFS_SB(sb) ((struct erofs_sb_info *)(sb)->s_fs_info)
@@ -423,6 +443,12 @@ int erofs_pcpubuf_growsize(unsigned int nrpages);
 void erofs_pcpubuf_init(void);
 void erofs_pcpubuf_exit(void);
 
+/* sysfs.c */
+int erofs_register_sysfs(struct super_block *sb);
+void erofs_unregister_sysfs(struct super_block *sb);
+int __init erofs_init_sysfs(void);
+void erofs_exit_sysfs(void);
+
 /* utils.c / zdata.c */
 struct page *erofs_allocpage(struct list_head *pool, gfp_t gfp);
 
@@ -446,6 +472,20 @@ int erofs_try_to_free_cached_page(struct address_space *mapping,
 int z_erofs_load_lz4_config(struct super_block *sb,
 			    struct erofs_super_block *dsb,
 			    struct z_erofs_lz4_cfgs *lz4, int len);
+
+/* zcache.c */
+void z_erofs_dcache_init(struct erofs_sb_info *sbi);
+void z_erofs_dcache_exit(struct erofs_sb_info *sbi);
+bool z_erofs_dcache_lookup(struct erofs_sb_info *sbi, pgoff_t index,
+			   unsigned int length, unsigned int pageofs,
+			   unsigned int outputsize, struct page **pages);
+void z_erofs_dcache_insert(struct erofs_sb_info *sbi, pgoff_t index,
+			   unsigned int length, unsigned int pageofs,
+			   unsigned int outputsize, struct page **pages);
+unsigned long z_erofs_dcache_count(void);
+unsigned long z_erofs_dcache_shrink(struct erofs_sb_info *sbi,
+				    unsigned long nr);
+void z_erofs_dcache_set_limit(struct erofs_sb_info *sbi, unsigned long limit);
 #else
 static inline void erofs_shrinker_register(struct super_block *sb) {}
 static inline void erofs_shrinker_unregister(struct super_block *sb) {}
@@ -453,6 +493,8 @@ static inline int erofs_init_shrinker(void) { return 0; }
 static inline void erofs_exit_shrinker(void) {}
 static inline int z_erofs_init_zip_subsystem(void) { return 0; }
 static inline void z_erofs_exit_zip_subsystem(void) {}
+static inline void z_erofs_dcache_init(struct erofs_sb_info *sbi) {}
+static inline void z_erofs_dcache_exit(struct erofs_sb_info *sbi) {}
 static inline int z_erofs_load_lz4_config(struct super_block *sb,
 				  struct erofs_super_block *dsb,
 				  struct z_erofs_lz4_cfgs *lz4, int len)
@@ -0,0 +1,165 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Per-filesystem sysfs interface under /sys/fs/erofs/<disk>.
+ */
+#include <linux/sysfs.h>
+#include <linux/kobject.h>
+
+#include "internal.h"
+
+struct erofs_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct erofs_sb_info *sbi, char *buf);
+	ssize_t (*store)(struct erofs_sb_info *sbi, const char *buf,
+			 size_t len);
+};
+
+#define EROFS_ATTR_RO(_name)						\
+static struct erofs_attr erofs_attr_##_name = __ATTR(_name, 0444,	\
+		erofs_##_name##_show, NULL)
+#define EROFS_ATTR_RW(_name)						\
+static struct erofs_attr erofs_attr_##_name = __ATTR(_name, 0644,	\
+		erofs_##_name##_show, erofs_##_name##_store)
+#define ATTR_LIST(_name) (&erofs_attr_##_name.attr)
+
+#ifdef CONFIG_EROFS_FS_ZIP
+static ssize_t erofs_decomp_cache_kb_show(struct erofs_sb_info *sbi, char *buf)
+{
+	return sysfs_emit(buf, "%lu\n", READ_ONCE(sbi->dcache.limit) >> 10);
+}
+
+static ssize_t erofs_decomp_cache_kb_store(struct erofs_sb_info *sbi,
+					   const char *buf, size_t len)
+{
+	unsigned long kb;
+	int ret;
+
+	ret = kstrtoul(buf, 0, &kb);
+	if (ret)
+		return ret;
+	if (kb > ULONG_MAX >> 10)
+		return -EINVAL;
+
+	z_erofs_dcache_set_limit(sbi, kb << 10);
+	return len;
+}
+EROFS_ATTR_RW(decomp_cache_kb);
+
+#define EROFS_DCACHE_STAT_ATTR(_name, _field, _fmt, _shift)		\
+static ssize_t erofs_##_name##_show(struct erofs_sb_info *sbi, char *buf) \
+{									\
+	return sysfs_emit(buf, _fmt "\n",				\
+			  READ_ONCE(sbi->dcache._field) >> (_shift));	\
+}									\
+EROFS_ATTR_RO(_name)
+
+EROFS_DCACHE_STAT_ATTR(decomp_cache_used_kb, size, "%lu", 10);
+EROFS_DCACHE_STAT_ATTR(decomp_cache_hits, hits, "%llu", 0);
+EROFS_DCACHE_STAT_ATTR(decomp_cache_misses, misses, "%llu", 0);
+EROFS_DCACHE_STAT_ATTR(decomp_cache_evictions, evictions, "%llu", 0);
+#endif
+
+static struct attribute *erofs_attrs[] = {
+#ifdef CONFIG_EROFS_FS_ZIP
+	ATTR_LIST(decomp_cache_kb),
+	ATTR_LIST(decomp_cache_used_kb),
+	ATTR_LIST(decomp_cache_hits),
+	ATTR_LIST(decomp_cache_misses),
+	ATTR_LIST(decomp_cache_evictions),
+#endif
+	NULL,
+};
+ATTRIBUTE_GROUPS(erofs);
+
+static ssize_t erofs_attr_show(struct kobject *kobj,
+			       struct attribute *attr, char *buf)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+	struct erofs_attr *a = container_of(attr, struct erofs_attr, attr);
+
+	return a->show ? a->show(sbi, buf) : 0;
+}
+
+static ssize_t erofs_attr_store(struct kobject *kobj, struct attribute *attr,
+				const char *buf, size_t len)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+	struct erofs_attr *a = container_of(attr, struct erofs_attr, attr);
+
+	return a->store ? a->store(sbi, buf, len) : -EPERM;
+}
+
+static void erofs_sb_release(struct kobject *kobj)
+{
+	struct erofs_sb_info *sbi = container_of(kobj, struct erofs_sb_info,
+						 s_kobj);
+
+	complete(&sbi->s_kobj_unregister);
+}
+
+static const struct sysfs_ops erofs_attr_ops = {
+	.show	= erofs_attr_show,
+	.store	= erofs_attr_store,
+};
+
+static struct kobj_type erofs_sb_ktype = {
+	.default_groups = erofs_groups,
+	.sysfs_ops	= &erofs_attr_ops,
+	.release	= erofs_sb_release,
+};
+
+static struct kobj_type erofs_ktype = {
+	.sysfs_ops	= &erofs_attr_ops,
+};
+
+static struct kset erofs_root = {
+	.kobj	= {.ktype = &erofs_ktype},
+};
+
+int erofs_register_sysfs(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+	int err;
+
+	sbi->s_kobj.kset = &erofs_root;
+	init_completion(&sbi->s_kobj_unregister);
+	err = kobject_init_and_add(&sbi->s_kobj, &erofs_sb_ktype, NULL,
+				   "%s", sb->s_id);
+	if (err) {
+		kobject_put(&sbi->s_kobj);
+		wait_for_completion(&sbi->s_kobj_unregister);
+	}
+	return err;
+}
+
+void erofs_unregister_sysfs(struct super_block *sb)
+{
+	struct erofs_sb_info *sbi = EROFS_SB(sb);
+
+	/* ->put_super() is also called if mounting failed before registering */
+	if (!sbi->s_kobj.state_in_sysfs)
+		return;
+
+	kobject_del(&sbi->s_kobj);
+	kobject_put(&sbi->s_kobj);
+	wait_for_completion(&sbi->s_kobj_unregister);
+}
+
+int __init erofs_init_sysfs(void)
+{
+	int ret;
+
+	kobject_set_name(&erofs_root.kobj, "erofs");
+	erofs_root.kobj.parent = fs_kobj;
+	ret = kset_register(&erofs_root);
+	if (ret)
+		kobject_put(&erofs_root.kobj);
+	return ret;
+}
+
+void erofs_exit_sysfs(void)
+{
+	kset_unregister(&erofs_root);
+}
@@ -208,7 +208,8 @@ void erofs_shrinker_unregister(struct super_block *sb)
 static unsigned long erofs_shrink_count(struct shrinker *shrink,
 					struct shrink_control *sc)
 {
-	return atomic_long_read(&erofs_global_shrink_cnt);
+	return atomic_long_read(&erofs_global_shrink_cnt) +
+		z_erofs_dcache_count();
 }
 
 static unsigned long erofs_shrink_scan(struct shrinker *shrink,
@@ -219,7 +220,14 @@ static unsigned long erofs_shrink_scan(struct shrinker *shrink,
 
 	unsigned long nr = sc->nr_to_scan;
 	unsigned int run_no;
-	unsigned long freed = 0;
+	unsigned long freed = 0, dcache_freed = 0;
+	unsigned long nr_dcache, dcache_cnt, cnt;
+
+	/* split the scan between workgroups and cached pages by their size */
+	dcache_cnt = z_erofs_dcache_count();
+	cnt = atomic_long_read(&erofs_global_shrink_cnt) + dcache_cnt;
+	nr_dcache = cnt ? mult_frac(nr, dcache_cnt, cnt) : 0;
+	nr -= nr_dcache;
 
 	spin_lock(&erofs_sb_list_lock);
 	do {
@@ -246,7 +254,11 @@ static unsigned long erofs_shrink_scan(struct shrinker *shrink,
 		spin_unlock(&erofs_sb_list_lock);
 		sbi->shrinker_run_no = run_no;
 
-		freed += erofs_shrink_workstation(sbi, nr - freed);
+		if (freed < nr)
+			freed += erofs_shrink_workstation(sbi, nr - freed);
+		if (dcache_freed < nr_dcache)
+			dcache_freed += z_erofs_dcache_shrink(sbi,
+						nr_dcache - dcache_freed);
 
 		spin_lock(&erofs_sb_list_lock);
 		/* Get the next list element before we move this one */
@@ -259,11 +271,11 @@ static unsigned long erofs_shrink_scan(struct shrinker *shrink,
 		list_move_tail(&sbi->list, &erofs_sb_list);
 		mutex_unlock(&sbi->umount_mutex);
 
-		if (freed >= nr)
+		if (freed >= nr && dcache_freed >= nr_dcache)
 			break;
 	}
 	spin_unlock(&erofs_sb_list_lock);
-	return freed;
+	return freed + dcache_freed;
 }
 
 static struct shrinker erofs_shrinker_info = {
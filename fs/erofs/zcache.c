@@ -0,0 +1,211 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Optional bounded cache of decompressed data for hot pclusters.
+ *
+ * The managed cache keeps compressed pages around, but once the page cache
+ * pages of a file are reclaimed they have to be decompressed again on the
+ * next access. Pclusters decompressed more than once (e.g. shared libraries
+ * touched on every app launch) keep a linear copy of their output here, so
+ * that a later read of the same pcluster, from any inode, is a memcpy()
+ * instead of another decompression. This only saves CPU: the compressed
+ * pages are still read (or found in the managed cache) as before.
+ *
+ * The cache is disabled unless /sys/fs/erofs/<disk>/decomp_cache_kb is set.
+ */
+#include "internal.h"
+
+struct z_erofs_dcache_entry {
+	struct list_head lru;
+	refcount_t refcount;
+	pgoff_t index;
+
+	/* pcl->length and pageofs the data was decompressed for */
+	unsigned int length;
+	unsigned int pageofs;
+	unsigned int size;
+
+	u8 data[];
+};
+
+/* don't let a single pcluster flush most of the cache */
+#define Z_EROFS_DCACHE_ENTRY_RATIO	4
+
+/* bytes cached over all superblocks, for the shrinker */
+static atomic_long_t z_erofs_dcache_total;
+
+void z_erofs_dcache_init(struct erofs_sb_info *sbi)
+{
+	struct z_erofs_dcache *dc = &sbi->dcache;
+
+	xa_init(&dc->entries);
+	INIT_LIST_HEAD(&dc->lru);
+}
+
+static void z_erofs_dcache_put(struct z_erofs_dcache_entry *e)
+{
+	if (refcount_dec_and_test(&e->refcount))
+		kfree(e);
+}
+
+/* must be called with xa_lock held */
+static void z_erofs_dcache_evict_locked(struct z_erofs_dcache *dc,
+					struct z_erofs_dcache_entry *e)
+{
+	__xa_erase(&dc->entries, e->index);
+	list_del(&e->lru);
+	dc->size -= e->size;
+	atomic_long_sub(e->size, &z_erofs_dcache_total);
+	++dc->evictions;
+	z_erofs_dcache_put(e);
+}
+
+/*
+ * evict from the LRU tail until the cache fits in @limit bytes or at least
+ * @nr bytes are gone, and return the number of bytes evicted
+ */
+static unsigned long z_erofs_dcache_trim_locked(struct z_erofs_dcache *dc,
+						unsigned long limit,
+						unsigned long nr)
+{
+	unsigned long freed = 0;
+	struct z_erofs_dcache_entry *e;
+
+	while (freed < nr && dc->size > limit) {
+		e = list_last_entry(&dc->lru, struct z_erofs_dcache_entry, lru);
+		freed += e->size;
+		z_erofs_dcache_evict_locked(dc, e);
+	}
+	return freed;
+}
+
+/* copy between the linear buffer and the output pages of a pcluster */
+static void z_erofs_dcache_copy(struct page **pages, unsigned int pageofs,
+				u8 *data, unsigned int size, bool to_pages)
+{
+	unsigned int i, cur = 0;
+
+	for (i = 0; cur < size; ++i) {
+		unsigned int start = i ? 0 : pageofs;
+		unsigned int len = min_t(unsigned int, PAGE_SIZE - start,
+					 size - cur);
+
+		if (pages[i]) {
+			u8 *dst = kmap_atomic(pages[i]);
+
+			if (to_pages)
+				memcpy(dst + start, data + cur, len);
+			else
+				memcpy(data + cur, dst + start, len);
+			kunmap_atomic(dst);
+		}
+		cur += len;
+	}
+}
+
+bool z_erofs_dcache_lookup(struct erofs_sb_info *sbi, pgoff_t index,
+			   unsigned int length, unsigned int pageofs,
+			   unsigned int outputsize, struct page **pages)
+{
+	struct z_erofs_dcache *dc = &sbi->dcache;
+	struct z_erofs_dcache_entry *e;
+
+	if (!READ_ONCE(dc->limit))
+		return false;
+
+	xa_lock(&dc->entries);
+	e = xa_load(&dc->entries, index);
+	if (!e || e->length != length || e->pageofs != pageofs ||
+	    e->size < outputsize) {
+		++dc->misses;
+		xa_unlock(&dc->entries);
+		return false;
+	}
+	refcount_inc(&e->refcount);
+	list_move(&e->lru, &dc->lru);
+	++dc->hits;
+	xa_unlock(&dc->entries);
+
+	z_erofs_dcache_copy(pages, pageofs, e->data, outputsize, true);
+	z_erofs_dcache_put(e);
+	return true;
+}
+
+void z_erofs_dcache_insert(struct erofs_sb_info *sbi, pgoff_t index,
+			   unsigned int length, unsigned int pageofs,
+			   unsigned int outputsize, struct page **pages)
+{
+	struct z_erofs_dcache *dc = &sbi->dcache;
+	unsigned long limit = READ_ONCE(dc->limit);
+	struct z_erofs_dcache_entry *e;
+	unsigned int i;
+
+	if (outputsize > limit / Z_EROFS_DCACHE_ENTRY_RATIO)
+		return;
+
+	/* the pages not requested this time can't be cached */
+	for (i = 0; i < PAGE_ALIGN(pageofs + outputsize) >> PAGE_SHIFT; ++i)
+		if (!pages[i])
+			return;
+
+	/* only an optimization, so never reclaim or wait for it */
+	e = kmalloc(struct_size(e, data, outputsize),
+		    GFP_NOWAIT | __GFP_NOWARN);
+	if (!e)
+		return;
+	refcount_set(&e->refcount, 1);
+	e->index = index;
+	e->length = length;
+	e->pageofs = pageofs;
+	e->size = outputsize;
+	z_erofs_dcache_copy(pages, pageofs, e->data, outputsize, false);
+
+	xa_lock(&dc->entries);
+	if (__xa_insert(&dc->entries, index, e, GFP_ATOMIC)) {
+		xa_unlock(&dc->entries);
+		kfree(e);
+		return;
+	}
+	list_add(&e->lru, &dc->lru);
+	dc->size += outputsize;
+	atomic_long_add(outputsize, &z_erofs_dcache_total);
+	z_erofs_dcache_trim_locked(dc, limit, ULONG_MAX);
+	xa_unlock(&dc->entries);
+}
+
+/* pages held by the caches of all superblocks */
+unsigned long z_erofs_dcache_count(void)
+{
+	return DIV_ROUND_UP(atomic_long_read(&z_erofs_dcache_total), PAGE_SIZE);
+}
+
+/* evict at least @nr pages worth of data and return the pages freed */
+unsigned long z_erofs_dcache_shrink(struct erofs_sb_info *sbi,
+				    unsigned long nr)
+{
+	struct z_erofs_dcache *dc = &sbi->dcache;
+	unsigned long freed;
+
+	if (!nr)
+		return 0;
+	nr = min(nr, ULONG_MAX >> PAGE_SHIFT);
+	xa_lock(&dc->entries);
+	freed = z_erofs_dcache_trim_locked(dc, 0, nr << PAGE_SHIFT);
+	xa_unlock(&dc->entries);
+	return DIV_ROUND_UP(freed, PAGE_SIZE);
+}
+
+void z_erofs_dcache_set_limit(struct erofs_sb_info *sbi, unsigned long limit)
+{
+	struct z_erofs_dcache *dc = &sbi->dcache;
+
+	xa_lock(&dc->entries);
+	WRITE_ONCE(dc->limit, limit);
+	z_erofs_dcache_trim_locked(dc, limit, ULONG_MAX);
+	xa_unlock(&dc->entries);
+}
+
+void z_erofs_dcache_exit(struct erofs_sb_info *sbi)
+{
+	z_erofs_dcache_set_limit(sbi, 0);
+	xa_destroy(&sbi->dcache.entries);
+}
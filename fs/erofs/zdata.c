@@ -8,6 +8,8 @@
 #include "compress.h"
 #include <linux/prefetch.h>
 #include <linux/cpuhotplug.h>
+#include <linux/sched/topology.h>
+#include <linux/topology.h>
 #include <trace/events/erofs.h>
 
 /*
@@ -1125,6 +1127,11 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 		partial = true;
 	}
 
+	if (!partial &&
+	    z_erofs_dcache_lookup(sbi, pcl->obj.index, pcl->length,
+				  cl->pageofs, outputsize, pages))
+		goto out;
+
 	inputsize = pcl->pclusterpages * PAGE_SIZE;
 	err = z_erofs_decompress(&(struct z_erofs_decompress_req) {
 					.sb = sb,
@@ -1138,6 +1145,12 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 					.partial_decoding = partial
 				 }, pagepool);
 
+	/* only keep pclusters which are decompressed again and again */
+	if (pcl->nr_decompressed < U8_MAX)
+		++pcl->nr_decompressed;
+	if (!err && !partial && pcl->nr_decompressed > 1)
+		z_erofs_dcache_insert(sbi, pcl->obj.index, pcl->length,
+				      cl->pageofs, outputsize, pages);
 out:
 	/* must handle all compressed pages before ending pages */
 	for (i = 0; i < pcl->pclusterpages; ++i) {
@@ -1187,12 +1200,12 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
-static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct list_head *pagepool)
+static void z_erofs_decompress_pclusters(struct super_block *sb,
+					 z_erofs_next_pcluster_t owned,
+					 unsigned int nr,
+					 struct list_head *pagepool)
 {
-	z_erofs_next_pcluster_t owned = io->head;
-
-	while (owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
+	while (nr-- && owned != Z_EROFS_PCLUSTER_TAIL_CLOSED) {
 		struct z_erofs_pcluster *pcl;
 
 		/* no possible that 'owned' equals Z_EROFS_WORK_TPTR_TAIL */
@@ -1204,8 +1217,168 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 		pcl = container_of(owned, struct z_erofs_pcluster, next);
 		owned = READ_ONCE(pcl->next);
 
-		z_erofs_decompress_pcluster(io->sb, pcl, pagepool);
+		z_erofs_decompress_pcluster(sb, pcl, pagepool);
+	}
+}
+
+static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
+				     struct list_head *pagepool)
+{
+	z_erofs_decompress_pclusters(io->sb, io->head, UINT_MAX, pagepool);
+}
+
+/*
+ * A large readahead completes as one long chain of pclusters. Rather than
+ * decompressing all of them on the worker that got the completion, cut the
+ * chain into up to Z_EROFS_SPLIT_MAX segments of at least
+ * Z_EROFS_SPLIT_MIN_PCLUSTERS and hand all but the first one to the workers
+ * of other online CPUs, preferably ones as fast as this one. Pclusters are independent, and a page shared by two
+ * of them is only ended once both parts are done (z_erofs_onlinepage_endio).
+ */
+#define Z_EROFS_SPLIT_MAX		4U
+#define Z_EROFS_SPLIT_MIN_PCLUSTERS	4U
+
+struct z_erofs_decompress_segment {
+	struct super_block *sb;
+	z_erofs_next_pcluster_t head;
+	unsigned int nr;
+
+	union {
+		struct work_struct work;
+		struct kthread_work kthread_work;
+	} u;
+};
+
+static void z_erofs_decompress_segment(struct z_erofs_decompress_segment *seg)
+{
+	LIST_HEAD(pagepool);
+
+	z_erofs_decompress_pclusters(seg->sb, seg->head, seg->nr, &pagepool);
+	put_pages_list(&pagepool);
+	kfree(seg);
+}
+
+static void z_erofs_decompress_segment_work(struct work_struct *work)
+{
+	z_erofs_decompress_segment(container_of(work,
+			struct z_erofs_decompress_segment, u.work));
+}
+
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+static void z_erofs_decompress_segment_kthread_work(struct kthread_work *work)
+{
+	z_erofs_decompress_segment(container_of(work,
+			struct z_erofs_decompress_segment, u.kthread_work));
+}
+#endif
+
+static void z_erofs_queue_segment(struct z_erofs_decompress_segment *seg,
+				  unsigned int cpu)
+{
+#ifdef CONFIG_EROFS_FS_PCPU_KTHREAD
+	struct kthread_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(z_erofs_pcpu_workers[cpu]);
+	if (worker) {
+		kthread_init_work(&seg->u.kthread_work,
+				  z_erofs_decompress_segment_kthread_work);
+		kthread_queue_work(worker, &seg->u.kthread_work);
+		rcu_read_unlock();
+		return;
 	}
+	rcu_read_unlock();
+#endif
+	INIT_WORK(&seg->u.work, z_erofs_decompress_segment_work);
+	queue_work(z_erofs_workqueue, &seg->u.work);
+}
+
+static z_erofs_next_pcluster_t z_erofs_next_owned(z_erofs_next_pcluster_t owned)
+{
+	return READ_ONCE(container_of(owned, struct z_erofs_pcluster,
+				      next)->next);
+}
+
+/*
+ * Picks @nr online CPUs other than this one for the segments: first those of
+ * its cluster, which share its cache, then those of the same capacity, then
+ * any. That way no segment runs on a little core while this one is on a big
+ * core, or the other way around. No more segments than online CPUs are made,
+ * but if some went offline meanwhile, the segments left over go to this CPU.
+ */
+static void z_erofs_segment_cpus(unsigned int *cpus, unsigned int nr)
+{
+	unsigned int this_cpu = raw_smp_processor_id(), cpu, n = 0, pass;
+	const struct cpumask *cluster = topology_cluster_cpumask(this_cpu);
+	unsigned long cap = arch_scale_cpu_capacity(this_cpu);
+	bool same_cluster, same_cap;
+
+	for (pass = 0; pass < 3; ++pass) {
+		for_each_cpu_wrap(cpu, cpu_online_mask, this_cpu + 1) {
+			if (cpu == this_cpu)
+				continue;
+			same_cluster = cpumask_test_cpu(cpu, cluster);
+			same_cap = arch_scale_cpu_capacity(cpu) == cap;
+			if ((pass == 0 && !same_cluster) ||
+			    (pass == 1 && (same_cluster || !same_cap)) ||
+			    (pass == 2 && (same_cluster || same_cap)))
+				continue;
+			cpus[n++] = cpu;
+			if (n == nr)
+				return;
+		}
+	}
+	while (n < nr)
+		cpus[n++] = this_cpu;
+}
+
+/* returns how many pclusters from io->head are left to the caller */
+static unsigned int z_erofs_split_queue(struct z_erofs_decompressqueue *io)
+{
+	struct z_erofs_decompress_segment *segs[Z_EROFS_SPLIT_MAX];
+	z_erofs_next_pcluster_t owned;
+	unsigned int cpus[Z_EROFS_SPLIT_MAX - 1];
+	unsigned int nr = 0, nr_segs, per_seg, i;
+
+	/* nothing is decompressed yet, so the whole chain is still intact */
+	for (owned = io->head; owned != Z_EROFS_PCLUSTER_TAIL_CLOSED;
+	     owned = z_erofs_next_owned(owned))
+		++nr;
+
+	nr_segs = min3(Z_EROFS_SPLIT_MAX, nr / Z_EROFS_SPLIT_MIN_PCLUSTERS,
+		       num_online_cpus());
+	if (nr_segs < 2)
+		return UINT_MAX;
+
+	for (i = 1; i < nr_segs; ++i) {
+		segs[i] = kmalloc(sizeof(*segs[i]), GFP_NOIO | __GFP_NOWARN);
+		if (!segs[i]) {
+			while (--i)
+				kfree(segs[i]);
+			return UINT_MAX;
+		}
+	}
+
+	/*
+	 * With at least Z_EROFS_SPLIT_MIN_PCLUSTERS per segment, every segment
+	 * gets some. Find all heads before queueing anything, a queued segment
+	 * resets ->next of the pclusters it is done with.
+	 */
+	per_seg = DIV_ROUND_UP(nr, nr_segs);
+	for (i = 0, owned = io->head; i < nr;
+	     ++i, owned = z_erofs_next_owned(owned)) {
+		if (!i || i % per_seg)
+			continue;
+
+		segs[i / per_seg]->sb = io->sb;
+		segs[i / per_seg]->head = owned;
+		segs[i / per_seg]->nr = min(per_seg, nr - i);
+	}
+
+	z_erofs_segment_cpus(cpus, nr_segs - 1);
+	for (i = 1; i < nr_segs; ++i)
+		z_erofs_queue_segment(segs[i], cpus[i - 1]);
+	return per_seg;
 }
 
 static void z_erofs_decompressqueue_work(struct work_struct *work)
@@ -1215,7 +1388,8 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	LIST_HEAD(pagepool);
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	z_erofs_decompress_pclusters(bgq->sb, bgq->head,
+				     z_erofs_split_queue(bgq), &pagepool);
 
 	put_pages_list(&pagepool);
 	kvfree(bgq);
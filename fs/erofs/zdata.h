@@ -70,6 +70,9 @@ struct z_erofs_pcluster {
 	/* I: compression algorithm format */
 	unsigned char algorithmformat;
 
+	/* L: how many times it has been decompressed, saturated */
+	unsigned char nr_decompressed;
+
 	/* A: compressed pages (can be cached or inplaced pages) */
 	struct page *compressed_pages[];
 };
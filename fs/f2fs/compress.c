@@ -611,6 +611,15 @@ static void *f2fs_vmap(struct page **pages, unsigned int count)
 	return buf;
 }
 
+static void f2fs_update_compress_throughput(struct f2fs_sb_info *sbi,
+				unsigned char alg, size_t rlen, size_t clen,
+				ktime_t time)
+{
+	atomic64_add(rlen, &sbi->compr_in_bytes[alg]);
+	atomic64_add(clen, &sbi->compr_out_bytes[alg]);
+	atomic64_add(ktime_to_ns(time), &sbi->compr_time_ns[alg]);
+}
+
 static int f2fs_compress_pages(struct compress_ctx *cc)
 {
 	struct f2fs_inode_info *fi = F2FS_I(cc->inode);
@@ -619,6 +628,7 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 	unsigned int max_len, new_nr_cpages;
 	struct page **new_cpages;
 	u32 chksum = 0;
+	ktime_t start;
 	int i, ret;
 
 	trace_f2fs_compress_pages_start(cc->inode, cc->cluster_idx,
@@ -659,9 +669,13 @@ static int f2fs_compress_pages(struct compress_ctx *cc)
 		goto out_vunmap_rbuf;
 	}
 
+	start = ktime_get();
 	ret = cops->compress_pages(cc);
 	if (ret)
 		goto out_vunmap_cbuf;
+	f2fs_update_compress_throughput(F2FS_I_SB(cc->inode),
+			fi->i_compress_algorithm, cc->rlen, cc->clen,
+			ktime_sub(ktime_get(), start));
 
 	max_len = PAGE_SIZE * (cc->cluster_size - 1) - COMPRESS_HEADER_SIZE;
 
@@ -1434,6 +1448,147 @@ static int f2fs_write_raw_pages(struct compress_ctx *cc,
 	return 0;
 }
 
+/* write out a cluster which f2fs_compress_pages() returned @err for */
+static int f2fs_write_compressed_cluster(struct compress_ctx *cc, int err,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	if (err == -EAGAIN) {
+		add_compr_block_stat(cc->inode, cc->cluster_size);
+		goto write;
+	} else if (err) {
+		f2fs_put_rpages_wbc(cc, wbc, true, 1);
+		goto destroy_out;
+	}
+
+	err = f2fs_write_compressed_pages(cc, submitted, wbc, io_type);
+	if (!err)
+		return 0;
+	f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
+write:
+	f2fs_bug_on(F2FS_I_SB(cc->inode), *submitted);
+
+	err = f2fs_write_raw_pages(cc, submitted, wbc, io_type);
+	f2fs_put_rpages_wbc(cc, wbc, false, 0);
+destroy_out:
+	f2fs_destroy_compress_ctx(cc, false);
+	return err;
+}
+
+/*
+ * With compress_threads=N, up to N clusters of one writeback pass are
+ * compressed by f2fs_compress_wq while the writeback thread keeps
+ * collecting pages. Their pages stay locked meanwhile, and the clusters
+ * are written out in the order they were queued, so block allocation
+ * stays in the writeback thread and sequential on disk.
+ */
+static struct workqueue_struct *f2fs_compress_wq;
+
+struct compress_job {
+	struct list_head list;		/* entry in compress_ctx.jobs */
+	struct work_struct work;
+	struct completion done;
+	struct compress_ctx cc;		/* owns the raw pages of the cluster */
+	int err;			/* result of f2fs_compress_pages() */
+};
+
+static void f2fs_compress_job_work(struct work_struct *work)
+{
+	struct compress_job *job = container_of(work, struct compress_job,
+									work);
+
+	job->err = f2fs_compress_pages(&job->cc);
+	complete(&job->done);
+}
+
+/* wait for the oldest queued cluster and write it out */
+static int f2fs_finish_compress_job(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct compress_job *job = list_first_entry(&cc->jobs,
+						struct compress_job, list);
+	int _submitted = 0, err;
+
+	wait_for_completion(&job->done);
+	list_del(&job->list);
+	cc->nr_jobs--;
+
+	err = f2fs_write_compressed_cluster(&job->cc, job->err, &_submitted,
+								wbc, io_type);
+	*submitted += _submitted;
+	kfree(job);
+	return err;
+}
+
+int f2fs_flush_compress_jobs(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	int ret = 0, err;
+
+	*submitted = 0;
+	/* every queued cluster has locked pages, so finish all of them */
+	while (cc->nr_jobs) {
+		err = f2fs_finish_compress_job(cc, submitted, wbc, io_type);
+		if (err && !ret)
+			ret = err;
+	}
+	return ret;
+}
+
+static int f2fs_queue_compress_job(struct compress_ctx *cc,
+					int *submitted,
+					struct writeback_control *wbc,
+					enum iostat_type io_type)
+{
+	struct f2fs_sb_info *sbi = F2FS_I_SB(cc->inode);
+	struct compress_job *job;
+	int ret = 0, err;
+
+	/* keep at most compress_threads clusters in flight */
+	while (cc->nr_jobs &&
+		cc->nr_jobs >= F2FS_OPTION(sbi).compress_threads) {
+		err = f2fs_finish_compress_job(cc, submitted, wbc, io_type);
+		if (err && !ret)
+			ret = err;
+	}
+
+	job = kmalloc(sizeof(*job), GFP_NOFS);
+	if (!job) {
+		int _submitted;
+
+		err = f2fs_flush_compress_jobs(cc, &_submitted, wbc, io_type);
+		*submitted += _submitted;
+		if (err && !ret)
+			ret = err;
+
+		_submitted = 0;
+		err = f2fs_write_compressed_cluster(cc, f2fs_compress_pages(cc),
+						&_submitted, wbc, io_type);
+		*submitted += _submitted;
+		return ret ? ret : err;
+	}
+
+	/* hand the raw pages over, cc gets a new rpages array for the next one */
+	job->cc = *cc;
+	INIT_LIST_HEAD(&job->cc.jobs);
+	job->cc.nr_jobs = 0;
+	cc->rpages = NULL;
+	cc->nr_rpages = 0;
+	cc->cluster_idx = NULL_CLUSTER;
+
+	init_completion(&job->done);
+	INIT_WORK(&job->work, f2fs_compress_job_work);
+	list_add_tail(&job->list, &cc->jobs);
+	cc->nr_jobs++;
+	queue_work(f2fs_compress_wq, &job->work);
+	return ret;
+}
+
 int f2fs_write_multi_pages(struct compress_ctx *cc,
 					int *submitted,
 					struct writeback_control *wbc,
@@ -1443,27 +1598,16 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 
 	*submitted = 0;
 	if (cluster_may_compress(cc)) {
-		err = f2fs_compress_pages(cc);
-		if (err == -EAGAIN) {
-			add_compr_block_stat(cc->inode, cc->cluster_size);
-			goto write;
-		} else if (err) {
-			f2fs_put_rpages_wbc(cc, wbc, true, 1);
-			goto destroy_out;
-		}
-
-		err = f2fs_write_compressed_pages(cc, submitted,
+		if (F2FS_OPTION(F2FS_I_SB(cc->inode)).compress_threads)
+			return f2fs_queue_compress_job(cc, submitted,
 							wbc, io_type);
-		if (!err)
-			return 0;
-		f2fs_bug_on(F2FS_I_SB(cc->inode), err != -EAGAIN);
+		return f2fs_write_compressed_cluster(cc,
+				f2fs_compress_pages(cc), submitted,
+				wbc, io_type);
 	}
-write:
-	f2fs_bug_on(F2FS_I_SB(cc->inode), *submitted);
 
 	err = f2fs_write_raw_pages(cc, submitted, wbc, io_type);
 	f2fs_put_rpages_wbc(cc, wbc, false, 0);
-destroy_out:
 	f2fs_destroy_compress_ctx(cc, false);
 	return err;
 }
@@ -1975,7 +2119,13 @@ int __init f2fs_init_compress_cache(void)
 	err = f2fs_init_dic_cache();
 	if (err)
 		goto free_cic;
+	f2fs_compress_wq = alloc_workqueue("f2fs_compress",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!f2fs_compress_wq)
+		goto free_dic;
 	return 0;
+free_dic:
+	f2fs_destroy_dic_cache();
 free_cic:
 	f2fs_destroy_cic_cache();
 out:
@@ -1984,6 +2134,7 @@ int __init f2fs_init_compress_cache(void)
 
 void f2fs_destroy_compress_cache(void)
 {
+	destroy_workqueue(f2fs_compress_wq);
 	f2fs_destroy_dic_cache();
 	f2fs_destroy_cic_cache();
 }
@@ -2953,6 +2953,8 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 		.cbuf = NULL,
 		.rlen = PAGE_SIZE * F2FS_I(inode)->i_cluster_size,
 		.private = NULL,
+		.jobs = LIST_HEAD_INIT(cc.jobs),
+		.nr_jobs = 0,
 	};
 #endif
 	int nr_pages;
@@ -3145,6 +3147,19 @@ static int f2fs_write_cache_pages(struct address_space *mapping,
 			retry = 0;
 		}
 	}
+	/* write out the clusters still being compressed by workers */
+	if (cc.nr_jobs) {
+		int ret2 = f2fs_flush_compress_jobs(&cc, &submitted,
+							wbc, io_type);
+
+		nwritten += submitted;
+		wbc->nr_to_write -= submitted;
+		if (ret2 && !ret) {
+			ret = ret2;
+			done = 1;
+			retry = 0;
+		}
+	}
 	if (f2fs_compressed_file(inode))
 		f2fs_destroy_compress_ctx(&cc, false);
 #endif
@@ -166,6 +166,7 @@ struct f2fs_mount_info {
 	bool compress_chksum;			/* compressed data chksum */
 	unsigned char compress_ext_cnt;		/* extension count */
 	int compress_mode;			/* compression mode */
+	unsigned int compress_threads;		/* clusters compressed in parallel */
 	unsigned char extensions[COMPRESS_EXT_NUM][F2FS_EXTENSION_LEN];	/* extensions */
 };
 
@@ -1498,6 +1499,8 @@ struct compress_ctx {
 	size_t clen;			/* valid data length in cbuf */
 	void *private;			/* payload buffer for specified compression algorithm */
 	void *private2;			/* extra payload buffer */
+	struct list_head jobs;		/* clusters being compressed by workers */
+	unsigned int nr_jobs;		/* number of clusters in jobs */
 };
 
 /* compress context for write IO path */
@@ -1562,6 +1565,7 @@ struct decompress_io_ctx {
 #define NULL_CLUSTER			((unsigned int)(~0))
 #define MIN_COMPRESS_LOG_SIZE		2
 #define MAX_COMPRESS_LOG_SIZE		8
+#define MAX_COMPRESS_THREADS		64
 #define MAX_COMPRESS_WINDOW_SIZE(log_size)	((PAGE_SIZE) << (log_size))
 
 struct f2fs_sb_info {
@@ -1790,6 +1794,11 @@ struct f2fs_sb_info {
 	u64 compr_saved_block;
 	u32 compr_new_inode;
 
+	/* For per-algorithm compression throughput statistics */
+	atomic64_t compr_in_bytes[COMPRESS_MAX];
+	atomic64_t compr_out_bytes[COMPRESS_MAX];
+	atomic64_t compr_time_ns[COMPRESS_MAX];
+
 	/* For compressed block cache */
 	struct inode *compress_inode;		/* cache compressed blocks */
 	unsigned int compress_percent;		/* cache page percentage */
@@ -4203,6 +4212,10 @@ int f2fs_write_multi_pages(struct compress_ctx *cc,
 						int *submitted,
 						struct writeback_control *wbc,
 						enum iostat_type io_type);
+int f2fs_flush_compress_jobs(struct compress_ctx *cc,
+						int *submitted,
+						struct writeback_control *wbc,
+						enum iostat_type io_type);
 int f2fs_is_compressed_cluster(struct inode *inode, pgoff_t index);
 void f2fs_update_read_extent_tree_range_compressed(struct inode *inode,
 				pgoff_t fofs, block_t blkaddr,
@@ -250,6 +250,34 @@ static ssize_t avg_vblocks_show(struct f2fs_attr *a,
 }
 #endif
 
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+static ssize_t compr_throughput_show(struct f2fs_attr *a,
+				struct f2fs_sb_info *sbi, char *buf)
+{
+	static const char * const algs[COMPRESS_MAX] = {
+		[COMPRESS_LZO] = "lzo",
+		[COMPRESS_LZ4] = "lz4",
+		[COMPRESS_ZSTD] = "zstd",
+		[COMPRESS_LZORLE] = "lzo-rle",
+	};
+	int len = 0, i;
+
+	for (i = 0; i < COMPRESS_MAX; i++) {
+		u64 in = atomic64_read(&sbi->compr_in_bytes[i]);
+		u64 ns = atomic64_read(&sbi->compr_time_ns[i]);
+
+		if (!ns)
+			continue;
+		/* bytes per microsecond are MB/s */
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+			"%s: in %llu KB, out %llu KB, %llu MB/s\n", algs[i],
+			in >> 10, atomic64_read(&sbi->compr_out_bytes[i]) >> 10,
+			div64_u64(in * NSEC_PER_USEC, ns));
+	}
+	return len;
+}
+#endif
+
 static ssize_t main_blkaddr_show(struct f2fs_attr *a,
 				struct f2fs_sb_info *sbi, char *buf)
 {
@@ -759,6 +787,9 @@ F2FS_GENERAL_RO_ATTR(encoding);
 F2FS_GENERAL_RO_ATTR(mounted_time_sec);
 F2FS_GENERAL_RO_ATTR(main_blkaddr);
 F2FS_GENERAL_RO_ATTR(pending_discard);
+#ifdef CONFIG_F2FS_FS_COMPRESSION
+F2FS_GENERAL_RO_ATTR(compr_throughput);
+#endif
 #ifdef CONFIG_F2FS_STAT_FS
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_foreground_calls, cp_count);
 F2FS_STAT_ATTR(STAT_INFO, f2fs_stat_info, cp_background_calls, bg_cp_count);
@@ -884,6 +915,7 @@ static struct attribute *f2fs_attrs[] = {
 	ATTR_LIST(compr_written_block),
 	ATTR_LIST(compr_saved_block),
 	ATTR_LIST(compr_new_inode),
+	ATTR_LIST(compr_throughput),
 #endif
 	/* For ATGC */
 	ATTR_LIST(atgc_candidate_ratio),
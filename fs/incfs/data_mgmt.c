@@ -12,6 +12,7 @@
 #include <linux/mm.h>
 #include <linux/namei.h>
 #include <linux/pagemap.h>
+#include <linux/percpu.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 #include <linux/workqueue.h>
@@ -36,12 +37,18 @@ static void zstd_free_workspace(struct work_struct *work)
 	struct delayed_work *dw = container_of(work, struct delayed_work, work);
 	struct mount_info *mi =
 		container_of(dw, struct mount_info, mi_zstd_cleanup_work);
+	int cpu;
 
-	mutex_lock(&mi->mi_zstd_workspace_mutex);
-	kvfree(mi->mi_zstd_workspace);
-	mi->mi_zstd_workspace = NULL;
-	mi->mi_zstd_stream = NULL;
-	mutex_unlock(&mi->mi_zstd_workspace_mutex);
+	for_each_possible_cpu(cpu) {
+		struct incfs_zstd_ctx *ctx =
+			per_cpu_ptr(mi->mi_zstd_ctxs, cpu);
+
+		mutex_lock(&ctx->zc_lock);
+		kvfree(ctx->zc_workspace);
+		ctx->zc_workspace = NULL;
+		ctx->zc_stream = NULL;
+		mutex_unlock(&ctx->zc_lock);
+	}
 }
 
 struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
@@ -51,6 +58,7 @@ struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
 	struct mount_info *mi = NULL;
 	int error = 0;
 	struct incfs_sysfs_node *node;
+	int cpu;
 
 	mi = kzalloc(sizeof(*mi), GFP_NOFS);
 	if (!mi)
@@ -70,10 +78,17 @@ struct mount_info *incfs_alloc_mount_info(struct super_block *sb,
 	spin_lock_init(&mi->pending_read_lock);
 	INIT_LIST_HEAD(&mi->mi_reads_list_head);
 	spin_lock_init(&mi->mi_per_uid_read_timeouts_lock);
-	mutex_init(&mi->mi_zstd_workspace_mutex);
 	INIT_DELAYED_WORK(&mi->mi_zstd_cleanup_work, zstd_free_workspace);
 	mutex_init(&mi->mi_le_mutex);
 
+	mi->mi_zstd_ctxs = alloc_percpu(struct incfs_zstd_ctx);
+	if (!mi->mi_zstd_ctxs) {
+		error = -ENOMEM;
+		goto err;
+	}
+	for_each_possible_cpu(cpu)
+		mutex_init(&per_cpu_ptr(mi->mi_zstd_ctxs, cpu)->zc_lock);
+
 	node = incfs_add_sysfs_node(options->sysfs_name, mi);
 	if (IS_ERR(node)) {
 		error = PTR_ERR(node);
@@ -167,7 +182,12 @@ void incfs_free_mount_info(struct mount_info *mi)
 	dput(mi->mi_incomplete_dir);
 	path_put(&mi->mi_backing_dir_path);
 	mutex_destroy(&mi->mi_dir_struct_mutex);
-	mutex_destroy(&mi->mi_zstd_workspace_mutex);
+	if (mi->mi_zstd_ctxs) {
+		for_each_possible_cpu(i)
+			mutex_destroy(
+				&per_cpu_ptr(mi->mi_zstd_ctxs, i)->zc_lock);
+		free_percpu(mi->mi_zstd_ctxs);
+	}
 	put_cred(mi->mi_owner);
 	kfree(mi->mi_log.rl_ring_buf);
 	for (i = 0; i < ARRAY_SIZE(mi->pseudo_file_xattr); ++i)
@@ -426,12 +446,17 @@ static ssize_t zstd_decompress_safe(struct mount_info *mi,
 	ssize_t result;
 	ZSTD_inBuffer inbuf = {.src = src.data,	.size = src.len};
 	ZSTD_outBuffer outbuf = {.dst = dst.data, .size = dst.len};
+	/*
+	 * Readers only contend here if they were preempted or migrated between
+	 * picking a context and locking it.
+	 */
+	struct incfs_zstd_ctx *ctx = raw_cpu_ptr(mi->mi_zstd_ctxs);
 
-	result = mutex_lock_interruptible(&mi->mi_zstd_workspace_mutex);
+	result = mutex_lock_interruptible(&ctx->zc_lock);
 	if (result)
 		return result;
 
-	if (!mi->mi_zstd_stream) {
+	if (!ctx->zc_stream) {
 		unsigned int workspace_size = ZSTD_DStreamWorkspaceBound(
 						INCFS_DATA_FILE_BLOCK_SIZE);
 		void *workspace = kvmalloc(workspace_size, GFP_NOFS);
@@ -450,18 +475,22 @@ static ssize_t zstd_decompress_safe(struct mount_info *mi,
 			goto out;
 		}
 
-		mi->mi_zstd_workspace = workspace;
-		mi->mi_zstd_stream = stream;
+		ctx->zc_workspace = workspace;
+		ctx->zc_stream = stream;
 	}
 
-	result = ZSTD_decompressStream(mi->mi_zstd_stream, &outbuf, &inbuf) ?
+	result = ZSTD_decompressStream(ctx->zc_stream, &outbuf, &inbuf) ?
 		-EBADMSG : outbuf.pos;
 
+	/* Don't leave a half decoded frame behind for the next block */
+	if (result < 0)
+		ZSTD_resetDStream(ctx->zc_stream);
+
 	mod_delayed_work(system_wq, &mi->mi_zstd_cleanup_work,
 			 msecs_to_jiffies(5000));
 
 out:
-	mutex_unlock(&mi->mi_zstd_workspace_mutex);
+	mutex_unlock(&ctx->zc_lock);
 	return result;
 }
 
@@ -668,18 +697,22 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 			      int block_index, struct mem_range data, u8 *buf)
 {
 	struct data_file *df = get_incfs_data_file(f);
+	struct mount_info *mi = df->df_mount_info;
+	struct address_space *mapping = f->f_inode->i_mapping;
 	u8 stored_digest[INCFS_MAX_HASH_SIZE] = {};
 	u8 calculated_digest[INCFS_MAX_HASH_SIZE] = {};
 	struct mtree *tree = NULL;
 	struct incfs_df_signature *sig = NULL;
 	int digest_size;
 	int hash_block_index = block_index;
-	int lvl;
+	int lvl, trusted_lvl;
 	int res;
 	loff_t hash_block_offset[INCFS_MAX_MTREE_LEVELS];
 	size_t hash_offset_in_block[INCFS_MAX_MTREE_LEVELS];
+	pgoff_t hash_page[INCFS_MAX_MTREE_LEVELS];
 	int hash_per_block;
 	pgoff_t file_pages;
+	u64 start_ns;
 
 	/*
 	 * Memory barrier to make sure tree is fully present if added via enable
@@ -692,6 +725,7 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 
 	digest_size = tree->alg->digest_size;
 	hash_per_block = INCFS_DATA_FILE_BLOCK_SIZE / digest_size;
+	file_pages = DIV_ROUND_UP(df->df_size, INCFS_DATA_FILE_BLOCK_SIZE);
 	for (lvl = 0; lvl < tree->depth; lvl++) {
 		loff_t lvl_off = tree->hash_level_suboffset[lvl];
 
@@ -700,31 +734,46 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 					     INCFS_DATA_FILE_BLOCK_SIZE);
 		hash_offset_in_block[lvl] = hash_block_index * digest_size %
 					    INCFS_DATA_FILE_BLOCK_SIZE;
+		hash_page[lvl] = file_pages +
+			hash_block_offset[lvl] / INCFS_DATA_FILE_BLOCK_SIZE;
 		hash_block_index /= hash_per_block;
 	}
 
+	/*
+	 * Hash pages that have been verified are kept in the page cache beyond
+	 * EOF with PageChecked set; the flag goes away with the page, so it
+	 * serves as the per-file bitmap of verified hash blocks. Walk up from
+	 * the leaf to the lowest trusted level - usually the leaf itself - so
+	 * only the levels below it need to be read and hashed.
+	 */
 	memcpy(stored_digest, tree->root_hash, digest_size);
+	for (trusted_lvl = 0; trusted_lvl < tree->depth; trusted_lvl++) {
+		struct page *page = find_get_page_flags(mapping,
+				hash_page[trusted_lvl], FGP_ACCESSED);
 
-	file_pages = DIV_ROUND_UP(df->df_size, INCFS_DATA_FILE_BLOCK_SIZE);
-	for (lvl = tree->depth - 1; lvl >= 0; lvl--) {
-		pgoff_t hash_page =
-			file_pages +
-			hash_block_offset[lvl] / INCFS_DATA_FILE_BLOCK_SIZE;
-		struct page *page = find_get_page_flags(
-			f->f_inode->i_mapping, hash_page, FGP_ACCESSED);
+		if (!page)
+			continue;
 
-		if (page && PageChecked(page)) {
+		if (PageChecked(page)) {
 			u8 *addr = kmap_atomic(page);
 
-			memcpy(stored_digest, addr + hash_offset_in_block[lvl],
+			memcpy(stored_digest,
+			       addr + hash_offset_in_block[trusted_lvl],
 			       digest_size);
 			kunmap_atomic(addr);
 			put_page(page);
-			continue;
+			break;
 		}
+		put_page(page);
+	}
 
-		if (page)
-			put_page(page);
+	mi->mi_hash_pages_cached += tree->depth - trusted_lvl;
+	if (!trusted_lvl)
+		goto verify_data;
+
+	start_ns = ktime_get_ns();
+	for (lvl = trusted_lvl - 1; lvl >= 0; lvl--) {
+		struct page *page;
 
 		res = incfs_kread(bfc, buf, INCFS_DATA_FILE_BLOCK_SIZE,
 				  hash_block_offset[lvl] + sig->hash_offset);
@@ -758,7 +807,7 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 		memcpy(stored_digest, buf + hash_offset_in_block[lvl],
 		       digest_size);
 
-		page = grab_cache_page(f->f_inode->i_mapping, hash_page);
+		page = grab_cache_page(mapping, hash_page[lvl]);
 		if (page) {
 			u8 *addr = kmap_atomic(page);
 
@@ -768,8 +817,11 @@ static int validate_hash_tree(struct backing_file_context *bfc, struct file *f,
 			unlock_page(page);
 			put_page(page);
 		}
+		mi->mi_hash_pages_verified++;
 	}
+	mi->mi_hash_pages_verify_ns += ktime_get_ns() - start_ns;
 
+verify_data:
 	res = incfs_calc_digest(tree->alg, data,
 				range(calculated_digest, digest_size));
 	if (res)
@@ -1337,6 +1389,110 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 	return result;
 }
 
+/*
+ * Reads up to count blocks starting at index into dst, one range per block,
+ * for readahead. Blocks stored back to back in the backing file are fetched
+ * with a single read before being decompressed and verified one by one, and
+ * verifying neighbouring blocks reuses the hash pages cached by the first.
+ *
+ * Stops without waiting at the first block that is missing or fails, so the
+ * caller can retry it through incfs_read_data_file_block(), which waits for
+ * pending blocks and reports errors. Returns the number of blocks read and
+ * sets the length of their ranges to the bytes read.
+ */
+int incfs_read_data_file_blocks(struct mem_range *dst, struct file *f,
+				int index, int count)
+{
+	struct data_file *df = get_incfs_data_file(f);
+	struct data_file_block *blocks = NULL;
+	struct backing_file_context *bfc;
+	struct mount_info *mi;
+	u8 *buf = NULL;
+	u8 *hash_buf = NULL;
+	int nr, done = 0;
+
+	if (!df)
+		return 0;
+
+	mi = df->df_mount_info;
+	bfc = df->df_backing_file_context;
+	count = min3(count, INCFS_READ_BATCH_BLOCKS,
+		     df->df_data_block_count - index);
+	if (count <= 0 || df->df_blockmap_off <= 0)
+		return 0;
+
+	blocks = kmalloc_array(count, sizeof(*blocks), GFP_NOFS);
+	buf = kvmalloc(count * INCFS_DATA_FILE_BLOCK_SIZE, GFP_NOFS);
+	hash_buf = (u8 *)__get_free_page(GFP_NOFS);
+	if (!blocks || !buf || !hash_buf)
+		goto out;
+
+	/* Find the run of blocks that are already present */
+	for (nr = 0; nr < count; nr++) {
+		struct data_file_segment *segment =
+			get_file_segment(df, index + nr);
+		int error;
+
+		if (down_read_killable(&segment->rwsem))
+			break;
+		error = get_data_file_block(df, index + nr, &blocks[nr]);
+		up_read(&segment->rwsem);
+
+		if (error || !is_data_block_present(&blocks[nr]))
+			break;
+	}
+
+	while (done < nr) {
+		loff_t pos = blocks[done].db_backing_file_data_offset;
+		size_t len = blocks[done].db_stored_size;
+		ssize_t result;
+		u8 *src = buf;
+		int run = 1;
+		int i;
+
+		while (done + run < nr &&
+		       blocks[done + run].db_backing_file_data_offset ==
+				pos + len) {
+			len += blocks[done + run].db_stored_size;
+			run++;
+		}
+
+		result = incfs_kread(bfc, buf, len, pos);
+		if (result != len)
+			goto out;
+
+		for (i = done; i < done + run; i++) {
+			size_t stored_size = blocks[i].db_stored_size;
+
+			if (blocks[i].db_comp_alg == COMPRESSION_NONE) {
+				result = min(dst[i].len, stored_size);
+				memcpy(dst[i].data, src, result);
+			} else {
+				result = decompress(mi, range(src, stored_size),
+						    dst[i], blocks[i].db_comp_alg);
+			}
+			src += stored_size;
+
+			if (result > 0 &&
+			    validate_hash_tree(bfc, f, index + i, dst[i],
+					       hash_buf) < 0)
+				result = -EBADMSG;
+			if (result < 0)
+				goto out;
+
+			dst[i].len = result;
+			log_block_read(mi, &df->df_id, index + i);
+			done++;
+		}
+	}
+
+out:
+	free_page((unsigned long)hash_buf);
+	kvfree(buf);
+	kfree(blocks);
+	return done;
+}
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset)
 {
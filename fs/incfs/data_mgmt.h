@@ -24,6 +24,9 @@
 
 #define SEGMENTS_PER_FILE 3
 
+/* Maximum number of blocks incfs_read_data_file_blocks() reads at once */
+#define INCFS_READ_BATCH_BLOCKS 32
+
 enum LOG_RECORD_TYPE {
 	FULL,
 	SAME_FILE,
@@ -116,6 +119,19 @@ struct read_log {
 	struct delayed_work ml_wakeup_work;
 };
 
+/*
+ * A zstd decompression context, mount_info keeps one per possible CPU in
+ * per-cpu memory so that the locks of different CPUs don't share a line
+ */
+struct incfs_zstd_ctx {
+	/* Protects the fields below */
+	struct mutex zc_lock;
+
+	void *zc_workspace;
+
+	ZSTD_DStream *zc_stream;
+};
+
 struct mount_options {
 	unsigned int read_timeout_ms;
 	unsigned int readahead_pages;
@@ -190,10 +206,8 @@ struct mount_info {
 	struct incfs_per_uid_read_timeouts *mi_per_uid_read_timeouts;
 	int mi_per_uid_read_timeouts_size;
 
-	/* zstd workspace */
-	struct mutex mi_zstd_workspace_mutex;
-	void *mi_zstd_workspace;
-	ZSTD_DStream *mi_zstd_stream;
+	/* zstd workspaces, indexed by CPU and allocated on first use */
+	struct incfs_zstd_ctx __percpu *mi_zstd_ctxs;
 	struct delayed_work mi_zstd_cleanup_work;
 
 	/* sysfs node */
@@ -237,6 +251,19 @@ struct mount_info {
 	 * time.
 	 */
 	u64 mi_reads_delayed_min_us;
+
+	/* Number of hash pages read from the backing file and verified */
+	u64 mi_hash_pages_verified;
+
+	/* Total time spent verifying those hash pages */
+	u64 mi_hash_pages_verify_ns;
+
+	/*
+	 * Number of hash page verifications skipped because the page was
+	 * already trusted. Multiplied by the average time per verified page,
+	 * this estimates the verification time saved.
+	 */
+	u64 mi_hash_pages_cached;
 };
 
 struct data_file_block {
@@ -432,6 +459,9 @@ ssize_t incfs_read_data_file_block(struct mem_range dst, struct file *f,
 			struct incfs_read_data_file_timeouts *timeouts,
 			unsigned int *delayed_min_us);
 
+int incfs_read_data_file_blocks(struct mem_range *dst, struct file *f,
+				int index, int count);
+
 ssize_t incfs_read_merkle_tree_blocks(struct mem_range dst,
 				      struct data_file *df, size_t offset);
 
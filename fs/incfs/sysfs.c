@@ -128,6 +128,9 @@ __DECLARE_STATUS_FLAG(reads_delayed_pending);
 __DECLARE_STATUS_FLAG64(reads_delayed_pending_us);
 __DECLARE_STATUS_FLAG(reads_delayed_min);
 __DECLARE_STATUS_FLAG64(reads_delayed_min_us);
+__DECLARE_STATUS_FLAG64(hash_pages_verified);
+__DECLARE_STATUS_FLAG64(hash_pages_verify_ns);
+__DECLARE_STATUS_FLAG64(hash_pages_cached);
 
 static struct attribute *mount_attributes[] = {
 	&reads_failed_timed_out_attr.attr,
@@ -137,6 +140,9 @@ static struct attribute *mount_attributes[] = {
 	&reads_delayed_pending_us_attr.attr,
 	&reads_delayed_min_attr.attr,
 	&reads_delayed_min_us_attr.attr,
+	&hash_pages_verified_attr.attr,
+	&hash_pages_verify_ns_attr.attr,
+	&hash_pages_cached_attr.attr,
 	NULL,
 };
 
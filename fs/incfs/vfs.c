@@ -46,6 +46,7 @@ static int dir_rename(struct inode *old_dir, struct dentry *old_dentry,
 static int file_open(struct inode *inode, struct file *file);
 static int file_release(struct inode *inode, struct file *file);
 static int read_single_page(struct file *f, struct page *page);
+static void readahead(struct readahead_control *rac);
 static long dispatch_ioctl(struct file *f, unsigned int req, unsigned long arg);
 
 #ifdef CONFIG_COMPAT
@@ -110,7 +111,7 @@ static const struct dentry_operations incfs_dentry_ops = {
 
 static const struct address_space_operations incfs_address_space_ops = {
 	.readpage = read_single_page,
-	/* .readpages = readpages */
+	.readahead = readahead,
 };
 
 static vm_fault_t incfs_fault(struct vm_fault *vmf)
@@ -476,18 +477,16 @@ static struct dentry *open_or_create_special_dir(struct dentry *backing_dir,
 	return index_dentry;
 }
 
-static int read_single_page_timeouts(struct data_file *df, struct file *f,
-				     int block_index, struct mem_range range,
-				     struct mem_range tmp,
-				     unsigned int *delayed_min_us)
+static void get_read_timeouts(struct mount_info *mi,
+			      struct incfs_read_data_file_timeouts *timeouts)
 {
-	struct mount_info *mi = df->df_mount_info;
-	struct incfs_read_data_file_timeouts timeouts = {
-		.max_pending_time_us = U32_MAX,
-	};
 	int uid = current_uid().val;
 	int i;
 
+	*timeouts = (struct incfs_read_data_file_timeouts) {
+		.max_pending_time_us = U32_MAX,
+	};
+
 	spin_lock(&mi->mi_per_uid_read_timeouts_lock);
 	for (i = 0; i < mi->mi_per_uid_read_timeouts_size /
 		sizeof(*mi->mi_per_uid_read_timeouts); ++i) {
@@ -495,21 +494,30 @@ static int read_single_page_timeouts(struct data_file *df, struct file *f,
 			&mi->mi_per_uid_read_timeouts[i];
 
 		if(t->uid == uid) {
-			timeouts.min_time_us = t->min_time_us;
-			timeouts.min_pending_time_us = t->min_pending_time_us;
-			timeouts.max_pending_time_us = t->max_pending_time_us;
+			timeouts->min_time_us = t->min_time_us;
+			timeouts->min_pending_time_us = t->min_pending_time_us;
+			timeouts->max_pending_time_us = t->max_pending_time_us;
 			break;
 		}
 	}
 	spin_unlock(&mi->mi_per_uid_read_timeouts_lock);
-	if (timeouts.max_pending_time_us == U32_MAX) {
+	if (timeouts->max_pending_time_us == U32_MAX) {
 		u64 read_timeout_us = (u64)mi->mi_options.read_timeout_ms *
 					1000;
 
-		timeouts.max_pending_time_us = read_timeout_us <= U32_MAX ?
+		timeouts->max_pending_time_us = read_timeout_us <= U32_MAX ?
 					       read_timeout_us : U32_MAX;
 	}
+}
 
+static int read_single_page_timeouts(struct data_file *df, struct file *f,
+				     int block_index, struct mem_range range,
+				     struct mem_range tmp,
+				     unsigned int *delayed_min_us)
+{
+	struct incfs_read_data_file_timeouts timeouts;
+
+	get_read_timeouts(df->df_mount_info, &timeouts);
 	return incfs_read_data_file_block(range, f, block_index, tmp,
 					  &timeouts, delayed_min_us);
 }
@@ -594,6 +602,81 @@ static int read_single_page(struct file *f, struct page *page)
 	return result;
 }
 
+/*
+ * Reads as many of the nr pages as possible in one batch, starting with the
+ * first one. Returns how many were read, those are uptodate and unlocked.
+ */
+static unsigned int read_pages_batch(struct file *f, struct data_file *df,
+				     struct page **pages, unsigned int nr)
+{
+	struct mem_range dst[INCFS_READ_BATCH_BLOCKS];
+	loff_t offset = page_offset(pages[0]);
+	int block_index;
+	int done;
+	int i;
+
+	if (offset >= df->df_size)
+		return 0;
+
+	nr = min_t(unsigned int, nr, ARRAY_SIZE(dst));
+	nr = min_t(loff_t, nr, DIV_ROUND_UP(df->df_size - offset, PAGE_SIZE));
+	for (i = 0; i < nr; i++)
+		dst[i] = range(kmap(pages[i]),
+			       min_t(loff_t, df->df_size - page_offset(pages[i]),
+				     PAGE_SIZE));
+
+	block_index = (offset + df->df_mapped_offset) /
+		INCFS_DATA_FILE_BLOCK_SIZE;
+	done = incfs_read_data_file_blocks(dst, f, block_index, nr);
+
+	for (i = 0; i < nr; i++) {
+		struct page *page = pages[i];
+
+		if (i < done) {
+			if (dst[i].len < PAGE_SIZE)
+				zero_user(page, dst[i].len,
+					  PAGE_SIZE - dst[i].len);
+			SetPageUptodate(page);
+			flush_dcache_page(page);
+		}
+		kunmap(page);
+		if (i < done)
+			unlock_page(page);
+	}
+
+	return done;
+}
+
+static void readahead(struct readahead_control *rac)
+{
+	struct file *f = rac->file;
+	struct data_file *df = get_incfs_data_file(f);
+	struct incfs_read_data_file_timeouts timeouts = {};
+	struct page *pages[INCFS_READ_BATCH_BLOCKS];
+	unsigned int nr, i;
+
+	/*
+	 * Reads throttled with a minimum time per block go page by page to
+	 * keep the delays, and so do pages whose blocks are missing or fail:
+	 * read_single_page() waits for pending blocks and reports errors.
+	 */
+	if (df)
+		get_read_timeouts(df->df_mount_info, &timeouts);
+
+	while ((nr = readahead_page_batch(rac, pages))) {
+		i = 0;
+		while (i < nr) {
+			if (df && !timeouts.min_time_us)
+				i += read_pages_batch(f, df, pages + i, nr - i);
+			if (i < nr)
+				read_single_page(f, pages[i++]);
+		}
+
+		for (i = 0; i < nr; i++)
+			put_page(pages[i]);
+	}
+}
+
 int incfs_link(struct dentry *what, struct dentry *where)
 {
 	struct dentry *parent_dentry = dget_parent(where);
@@ -220,6 +220,11 @@ struct damos_stat {
  * @quota:		Control the aggressiveness of this scheme.
  * @wmarks:		Watermarks for automated (in)activation of this scheme.
  * @stat:		Statistics of this scheme.
+ * @memcg:		If set, only pages charged to this memcg are handled.
+ * @skip_memcgs:	Pages charged to these memcgs are not handled.
+ * @nr_skip_memcgs:	Number of entries in &skip_memcgs.
+ * @anon_only:		Only anonymous pages are handled.
+ * @sz_filter_passed:	Bytes of the last region that passed the filters.
  * @list:		List head for siblings.
  *
  * For each aggregation interval, DAMON finds regions which fit in the
@@ -239,6 +244,13 @@ struct damos_stat {
  * After applying the &action to each region, &stat_count and &stat_sz is
  * updated to reflect the number of regions and total size of regions that the
  * &action is applied.
+ *
+ * &memcg, &skip_memcgs and &anon_only narrow the pages of a region that
+ * &action is applied to.  Only the physical address space primitives support
+ * these.  The user of the scheme has to keep the memcgs and the &skip_memcgs
+ * array around while the scheme exists.  For a scheme using any of these
+ * filters, the primitive sets &sz_filter_passed when applying &action, and
+ * the size quota is charged with it instead of the size of the whole region.
  */
 struct damos {
 	unsigned long min_sz_region;
@@ -251,6 +263,11 @@ struct damos {
 	struct damos_quota quota;
 	struct damos_watermarks wmarks;
 	struct damos_stat stat;
+	struct mem_cgroup *memcg;
+	struct mem_cgroup **skip_memcgs;
+	unsigned int nr_skip_memcgs;
+	bool anon_only;
+	unsigned long sz_filter_passed;
 	struct list_head list;
 };
 
@@ -336,6 +336,7 @@ enum lruvec_flags {
 
 struct lruvec;
 struct page_vma_mapped_walk;
+struct seq_file;
 
 #define LRU_GEN_MASK		((BIT(LRU_GEN_WIDTH) - 1) << LRU_GEN_PGOFF)
 #define LRU_REFS_MASK		((BIT(LRU_REFS_WIDTH) - 1) << LRU_REFS_PGOFF)
@@ -456,6 +457,9 @@ void lru_gen_look_around(struct page_vma_mapped_walk *pvmw);
 #ifdef CONFIG_MEMCG
 void lru_gen_init_memcg(struct mem_cgroup *memcg);
 void lru_gen_exit_memcg(struct mem_cgroup *memcg);
+void lru_gen_memcg_show(struct seq_file *m, struct mem_cgroup *memcg);
+int lru_gen_memcg_reclaim(struct mem_cgroup *memcg, unsigned long min_age,
+			  unsigned long nr_to_reclaim);
 #endif
 
 #else /* !CONFIG_LRU_GEN */
@@ -31,6 +31,8 @@ struct pagevec;
 				 SWAP_FLAG_DISCARD | SWAP_FLAG_DISCARD_ONCE | \
 				 SWAP_FLAG_DISCARD_PAGES)
 #define SWAP_BATCH 64
+/* batch size when all swap devices do synchronous I/O, e.g. zram */
+#define SWAP_BATCH_SYNC_IO 512
 
 static inline int current_is_kswapd(void)
 {
@@ -457,6 +459,7 @@ extern struct page *swapin_readahead(swp_entry_t entry, gfp_t flag,
 extern atomic_long_t nr_swap_pages;
 extern long total_swap_pages;
 extern atomic_t nr_rotate_swap;
+extern atomic_t nr_async_swap;
 extern bool has_usable_swap(void);
 
 /* Swap 50% full? Release swapcache more aggressively.. */
@@ -481,6 +484,7 @@ extern int swap_duplicate(swp_entry_t);
 extern int swapcache_prepare(swp_entry_t);
 extern void swap_free(swp_entry_t);
 extern void swapcache_free_entries(swp_entry_t *entries, int n);
+extern void swapcache_recycle_entries(swp_entry_t *entries, int n);
 extern int free_swap_and_cache(swp_entry_t);
 int swap_type_of(dev_t device, sector_t offset);
 int find_first_swap(dev_t *device);
@@ -7,8 +7,9 @@
 #include <linux/mutex.h>
 
 #define SWAP_SLOTS_CACHE_SIZE			SWAP_BATCH
-#define THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE	(5*SWAP_SLOTS_CACHE_SIZE)
-#define THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE	(2*SWAP_SLOTS_CACHE_SIZE)
+#define SWAP_SLOTS_CACHE_SIZE_SYNC_IO		SWAP_BATCH_SYNC_IO
+#define THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE(batch)	(5*(batch))
+#define THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE(batch)	(2*(batch))
 
 struct swap_slots_cache {
 	bool		lock_initialized;
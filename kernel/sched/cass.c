@@ -37,17 +37,80 @@ struct cass_cpu_cand {
 	unsigned long util;
 };
 
+/* The parts of a CPU's runqueue which CASS looks at for every wakeup */
+struct cass_cpu_stats {
+	unsigned long util_avg;
+	unsigned long util_est;
+	unsigned long hard_util;
+	unsigned long thermal;
+};
+
+/*
+ * Reading the above straight from a candidate's runqueue touches several
+ * cache lines which that CPU writes to all the time, and a wakeup does so for
+ * every allowed CPU. Instead, each CPU publishes them in a cache line of its
+ * own whenever they change, and wakeups just read that.
+ */
+struct cass_cpu_snapshot {
+	seqcount_t seq;
+	struct cass_cpu_stats stats;
+};
+
+static DEFINE_PER_CPU_SHARED_ALIGNED(struct cass_cpu_snapshot, cass_snapshot);
+
 static __always_inline
-void cass_cpu_util(struct cass_cpu_cand *c, int this_cpu, bool sync)
+void cass_cpu_stats_read(struct rq *rq, struct cass_cpu_stats *s)
+{
+	s->util_avg = READ_ONCE(rq->cfs.avg.util_avg);
+	s->util_est = READ_ONCE(rq->cfs.avg.util_est);
+	s->hard_util = cpu_util_rt(rq) + cpu_util_dl(rq) + cpu_util_irq(rq);
+	s->thermal = thermal_load_avg(rq);
+}
+
+/* Called with @rq's lock held, which serializes the writers of its snapshot */
+void __cass_update_snapshot(struct rq *rq)
+{
+	struct cass_cpu_snapshot *snap = per_cpu_ptr(&cass_snapshot, cpu_of(rq));
+	struct cass_cpu_stats s;
+
+	/* Don't dirty the cache line for nothing, it's read by other CPUs */
+	cass_cpu_stats_read(rq, &s);
+	if (!memcmp(&s, &snap->stats, sizeof(s)))
+		return;
+
+	raw_write_seqcount_begin(&snap->seq);
+	snap->stats = s;
+	raw_write_seqcount_end(&snap->seq);
+}
+
+static __always_inline
+void cass_cpu_stats_get(int cpu, struct cass_cpu_stats *s)
+{
+	struct cass_cpu_snapshot *snap;
+	unsigned int seq;
+
+	if (!sched_feat(CASS_SNAPSHOT)) {
+		cass_cpu_stats_read(cpu_rq(cpu), s);
+		return;
+	}
+
+	snap = per_cpu_ptr(&cass_snapshot, cpu);
+	do {
+		seq = raw_read_seqcount_begin(&snap->seq);
+		*s = snap->stats;
+	} while (read_seqcount_retry(&snap->seq, seq));
+}
+
+static __always_inline
+void cass_cpu_util(struct cass_cpu_cand *c, const struct cass_cpu_stats *s,
+		   int this_cpu, bool sync)
 {
-	struct rq *rq = cpu_rq(c->cpu);
-	struct cfs_rq *cfs_rq = &rq->cfs;
 	unsigned long est;
 
 	/* Get this CPU's utilization from CFS tasks */
-	c->util = READ_ONCE(cfs_rq->avg.util_avg);
+	c->util = s->util_avg;
 	if (sched_feat(UTIL_EST)) {
-		est = READ_ONCE(cfs_rq->avg.util_est);
+		est = s->util_est;
 		if (est > c->util) {
 			/* Don't deduct @current's util from estimated util */
 			sync = false;
@@ -63,7 +126,7 @@ void cass_cpu_util(struct cass_cpu_cand *c, int this_cpu, bool sync)
 		c->util -= min(c->util, task_util(current));
 
 	/* Get the utilization of everything other than CFS tasks */
-	c->hard_util = cpu_util_rt(rq) + cpu_util_dl(rq) + cpu_util_irq(rq);
+	c->hard_util = s->hard_util;
 
 	/*
 	 * Account for lost capacity due to time spent in RT/DL tasks and IRQs.
@@ -77,16 +140,43 @@ void cass_cpu_util(struct cass_cpu_cand *c, int this_cpu, bool sync)
 	c->cap_no_therm = c->cap_orig - min(c->hard_util, c->cap_orig - 1);
 }
 
-/* Returns true if @a is a better CPU than @b */
+/*
+ * A waker which woke @p last time too, and has hardly woken anything else
+ * lately (see record_wakee()), forms a pair with @p, e.g. a producer and its
+ * consumer or a binder client and its server. Keeping the two within a
+ * cluster lets them share its L2.
+ */
+#define CASS_PAIR_MAX_FLIPS 2
+
+DEFINE_PER_CPU(struct cass_pair_stats, cass_pair_stats);
+
+static __always_inline bool cass_wake_pair(struct task_struct *p)
+{
+	return !in_interrupt() && current->last_wakee == p &&
+	       current->wakee_flips <= CASS_PAIR_MAX_FLIPS;
+}
+
+static __always_inline bool cass_share_cluster(int cpu, int pair_cpu)
+{
+	return cpumask_test_cpu(cpu, topology_cluster_cpumask(pair_cpu));
+}
+
+/*
+ * Returns true if @a is a better CPU than @b. @paired tells whether sharing a
+ * cluster with @pair_cpu decided it, either way.
+ */
 static __always_inline
 bool cass_cpu_better(const struct cass_cpu_cand *a,
 		     const struct cass_cpu_cand *b,
-		     int this_cpu, int prev_cpu, bool sync)
+		     int this_cpu, int prev_cpu, bool sync, int pair_cpu,
+		     bool *paired)
 {
 #define cass_cmp(a, b) ({ res = (a) - (b); })
 #define cass_eq(a, b) ({ res = (a) == (b); })
 	long res;
 
+	*paired = false;
+
 	/* Prefer the CPU that's not overloaded */
 	if (cass_cmp(b->eff_util / b->cap_max, a->eff_util / a->cap_max))
 		goto done;
@@ -109,6 +199,14 @@ bool cass_cpu_better(const struct cass_cpu_cand *a,
 	if (sync && (cass_eq(a->cpu, this_cpu) || !cass_cmp(b->cpu, this_cpu)))
 		goto done;
 
+	/* Prefer the CPU that shares a cluster with the waker of a pair */
+	if (pair_cpu >= 0 &&
+	    cass_cmp(cass_share_cluster(a->cpu, pair_cpu),
+		     cass_share_cluster(b->cpu, pair_cpu))) {
+		*paired = true;
+		goto done;
+	}
+
 	/* Prefer the CPU with higher capacity */
 	if (cass_cmp(a->cap, b->cap))
 		goto done;
@@ -132,14 +230,15 @@ bool cass_cpu_better(const struct cass_cpu_cand *a,
 	return res > 0;
 }
 
-int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
+static int __cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync,
+			   bool rt, bool pair)
 {
 	/* Initialize @best such that @best always has a valid CPU at the end */
 	struct cass_cpu_cand cands[2], *best = cands;
 	int this_cpu = raw_smp_processor_id();
 	unsigned long p_util, uc_min;
-	bool has_idle = false;
-	int cidx = 0, cpu;
+	bool has_idle = false, paired, best_paired = false;
+	int cidx = 0, cpu, pair_cpu = -1;
 
 	/*
 	 * Get the utilization and uclamp minimum threshold for this task. Note
@@ -148,6 +247,12 @@ int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
 	p_util = rt ? 0 : task_util_est(p);
 	uc_min = uclamp_eff_value(p, UCLAMP_MIN);
 
+	/* Keep @p near @current if @current keeps waking it */
+	if (pair) {
+		pair_cpu = this_cpu;
+		this_cpu_inc(cass_pair_stats.wakeups);
+	}
+
 	/*
 	 * Find the best CPU to wake @p on. Although idle_get_state() requires
 	 * an RCU read lock, an RCU read lock isn't needed because we're not
@@ -164,12 +269,15 @@ int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
 		struct cass_cpu_cand *curr = &cands[cidx];
 		struct cpuidle_state *idle_state;
 		struct rq *rq = cpu_rq(cpu);
+		struct cass_cpu_stats stats;
+
+		cass_cpu_stats_get(cpu, &stats);
 
 		/* Get the original, maximum _possible_ capacity of this CPU */
 		curr->cap_orig = arch_scale_cpu_capacity(cpu);
 
 		/* Get the _current_, throttled maximum capacity of this CPU */
-		curr->cap_max = curr->cap_orig - thermal_load_avg(rq);
+		curr->cap_max = curr->cap_orig - stats.thermal;
 
 		/* Prefer the CPU that more closely meets the uclamp minimum */
 		if (curr->cap_max < uc_min && curr->cap_max < best->cap_max)
@@ -211,7 +319,7 @@ int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
 
 		/* Get this CPU's capacity and utilization */
 		curr->cpu = cpu;
-		cass_cpu_util(curr, this_cpu, sync);
+		cass_cpu_util(curr, &stats, this_cpu, sync);
 
 		/*
 		 * Add @p's utilization to this CPU if it's not @p's CPU, to
@@ -255,22 +363,39 @@ int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
 		 * If @best == @curr then there's no need to compare them, but
 		 * cidx still needs to be changed to the other candidate slot.
 		 */
-		if (best == curr ||
-		    cass_cpu_better(curr, best, this_cpu, prev_cpu, sync)) {
+		if (best == curr) {
+			cidx ^= 1;
+		} else if (cass_cpu_better(curr, best, this_cpu, prev_cpu,
+					   sync, pair_cpu, &paired)) {
+			/* only count the pair if it picked the final @best */
+			best_paired = paired;
 			best = curr;
 			cidx ^= 1;
+		} else if (paired) {
+			best_paired = true;
 		}
 	}
 
+	if (pair_cpu >= 0) {
+		if (best_paired)
+			this_cpu_inc(cass_pair_stats.decided);
+		if (best->cpu != prev_cpu)
+			this_cpu_inc(cass_pair_stats.migrations);
+	}
+
 	return best->cpu;
 }
 
+int cass_best_cpu(struct task_struct *p, int prev_cpu, bool sync, bool rt)
+{
+	return __cass_best_cpu(p, prev_cpu, sync, rt, cass_wake_pair(p));
+}
 EXPORT_SYMBOL_GPL(cass_best_cpu);
 
 static int cass_select_task_rq(struct task_struct *p, int prev_cpu,
 			       int wake_flags, bool rt)
 {
-	bool sync;
+	bool sync, pair;
 
 	/* Don't balance on exec since we don't know what @p will look like */
 	if (wake_flags & SD_BALANCE_EXEC)
@@ -284,12 +409,21 @@ static int cass_select_task_rq(struct task_struct *p, int prev_cpu,
 	if (unlikely(!cpumask_intersects(p->cpus_ptr, cpu_active_mask)))
 		return cpumask_first(p->cpus_ptr);
 
+	/*
+	 * Find out whether @current keeps waking @p before recording this
+	 * wakeup, which makes @p its last wakee. Like wake_wide(), only CFS
+	 * wakeups are recorded.
+	 */
+	pair = cass_wake_pair(p);
+	if (!rt && (wake_flags & WF_TTWU))
+		record_wakee(p);
+
 	/* cass_best_cpu() needs the CFS task's utilization, so sync it up */
 	if (!rt && !(wake_flags & SD_BALANCE_FORK))
 		sync_entity_load_avg(&p->se);
 
 	sync = (wake_flags & WF_SYNC) && !(current->flags & PF_EXITING);
-	return cass_best_cpu(p, prev_cpu, sync, rt);
+	return __cass_best_cpu(p, prev_cpu, sync, rt, pair);
 }
 
 static int cass_select_task_rq_fair(struct task_struct *p, int prev_cpu,
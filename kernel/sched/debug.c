@@ -336,6 +336,27 @@ static const struct file_operations sched_debug_fops = {
 
 static struct dentry *debugfs_sched;
 
+#ifdef CONFIG_SCHED_CASS
+static int cass_pairs_show(struct seq_file *m, void *v)
+{
+	struct cass_pair_stats sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct cass_pair_stats *s = per_cpu_ptr(&cass_pair_stats, cpu);
+
+		sum.wakeups += READ_ONCE(s->wakeups);
+		sum.decided += READ_ONCE(s->decided);
+		sum.migrations += READ_ONCE(s->migrations);
+	}
+
+	seq_printf(m, "wakeups %lu\ndecided %lu\nmigrations %lu\n",
+		   sum.wakeups, sum.decided, sum.migrations);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(cass_pairs);
+#endif
+
 static __init int sched_init_debug(void)
 {
 	struct dentry __maybe_unused *numa;
@@ -357,6 +378,9 @@ static __init int sched_init_debug(void)
 	debugfs_create_file("tunable_scaling", 0644, debugfs_sched, NULL, &sched_scaling_fops);
 	debugfs_create_u32("migration_cost_ns", 0644, debugfs_sched, &sysctl_sched_migration_cost);
 	debugfs_create_u32("nr_migrate", 0644, debugfs_sched, &sysctl_sched_nr_migrate);
+#ifdef CONFIG_SCHED_CASS
+	debugfs_create_file("cass_pairs", 0444, debugfs_sched, NULL, &cass_pairs_fops);
+#endif
 
 	mutex_lock(&sched_domains_mutex);
 	update_sched_domain_debugfs();
@@ -3741,6 +3741,7 @@ static inline void cfs_rq_util_change(struct cfs_rq *cfs_rq, int flags)
 		 *
 		 * See cpu_util_cfs().
 		 */
+		cass_update_snapshot(rq);
 		cpufreq_update_util(rq, flags);
 	}
 }
@@ -4590,6 +4591,7 @@ static inline void util_est_enqueue(struct cfs_rq *cfs_rq,
 	enqueued  = cfs_rq->avg.util_est;
 	enqueued += _task_util_est(p);
 	WRITE_ONCE(cfs_rq->avg.util_est, enqueued);
+	cass_update_snapshot(rq_of(cfs_rq));
 
 	trace_sched_util_est_cfs_tp(cfs_rq);
 }
@@ -4606,6 +4608,7 @@ static inline void util_est_dequeue(struct cfs_rq *cfs_rq,
 	enqueued  = cfs_rq->avg.util_est;
 	enqueued -= min_t(unsigned int, enqueued, _task_util_est(p));
 	WRITE_ONCE(cfs_rq->avg.util_est, enqueued);
+	cass_update_snapshot(rq_of(cfs_rq));
 
 	trace_sched_util_est_cfs_tp(cfs_rq);
 }
@@ -9239,8 +9242,10 @@ static void update_blocked_averages(int cpu)
 	decayed |= __update_blocked_fair(rq, &done);
 
 	update_blocked_load_status(rq, !done);
-	if (decayed)
+	if (decayed) {
+		cass_update_snapshot(rq);
 		cpufreq_update_util(rq, 0);
+	}
 	rq_unlock_irqrestore(rq, &rf);
 }
 
@@ -97,5 +97,13 @@ SCHED_FEAT(UTIL_EST, true)
 
 SCHED_FEAT(LATENCY_WARN, false)
 
+#ifdef CONFIG_SCHED_CASS
+/*
+ * Keep per-CPU snapshots with cass_update_snapshot() and read them on
+ * wakeup instead of each candidate's runqueue.
+ */
+SCHED_FEAT(CASS_SNAPSHOT, true)
+#endif
+
 
 SCHED_FEAT(HZ_BW, true)
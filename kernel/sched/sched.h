@@ -2997,6 +2997,31 @@ static inline void cpufreq_update_util(struct rq *rq, unsigned int flags)
 static inline void cpufreq_update_util(struct rq *rq, unsigned int flags) {}
 #endif /* CONFIG_CPU_FREQ */
 
+#ifdef CONFIG_SCHED_CASS
+void __cass_update_snapshot(struct rq *rq);
+
+/*
+ * Only kept while wakeups read the snapshots. Once CASS_SNAPSHOT is turned
+ * back on, a CPU's snapshot is stale until its runqueue next changes or it
+ * next ticks.
+ */
+static inline void cass_update_snapshot(struct rq *rq)
+{
+	if (sched_feat(CASS_SNAPSHOT))
+		__cass_update_snapshot(rq);
+}
+
+/* Wakeups of a task which forms a waker/wakee pair with @current */
+struct cass_pair_stats {
+	unsigned long wakeups;
+	unsigned long decided;		/* the pair's cluster picked the CPU */
+	unsigned long migrations;	/* the wakee left its previous CPU */
+};
+DECLARE_PER_CPU(struct cass_pair_stats, cass_pair_stats);
+#else
+static inline void cass_update_snapshot(struct rq *rq) {}
+#endif
+
 #ifdef arch_scale_freq_capacity
 # ifndef arch_scale_freq_invariant
 #  define arch_scale_freq_invariant()	true
@@ -64,6 +64,25 @@ struct cluster_data {
 	cpumask_t		nrrun_cpu_misfit_mask;
 	cpumask_t		assist_cpu_mask;
 	cpumask_t		assist_cpu_misfit_mask;
+
+	/* need forecasting, see update_need_forecast() */
+	bool			forecast;
+	unsigned int		forecast_need;
+	unsigned int		last_task_need;
+	unsigned int		burst_need;
+	unsigned int		burst_period;
+	bool			burst_period_stable;
+	bool			rising;
+	u64			nr_windows;
+	u64			burst_window;
+	u64			forecast_hits;
+	u64			forecast_misses;
+	u64			forecast_excess;
+
+	/* time from asking for more CPUs until they are resumed */
+	u64			unpause_req_ns;
+	u64			unpause_lat_ns;
+	u64			unpause_lat_max_ns;
 };
 
 struct cpu_data {
@@ -308,6 +327,57 @@ static ssize_t show_enable(const struct cluster_data *state, char *buf)
 	return scnprintf(buf, PAGE_SIZE, "%u\n", state->enable);
 }
 
+static ssize_t store_forecast(struct cluster_data *state,
+			      const char *buf, size_t count)
+{
+	unsigned int val;
+	unsigned long flags;
+	bool bval;
+
+	if (sscanf(buf, "%u\n", &val) != 1)
+		return -EINVAL;
+
+	bval = !!val;
+	if (bval != state->forecast) {
+		spin_lock_irqsave(&state_lock, flags);
+		/* start over, the history stopped being tracked when disabled */
+		state->nr_windows = 0;
+		state->burst_window = 0;
+		state->burst_period = 0;
+		state->burst_period_stable = false;
+		state->rising = false;
+		state->last_task_need = 0;
+		state->forecast_need = 0;
+		state->forecast = bval;
+		spin_unlock_irqrestore(&state_lock, flags);
+		sysfs_param_changed(state);
+	}
+
+	return count;
+}
+
+static ssize_t show_forecast(const struct cluster_data *state, char *buf)
+{
+	return scnprintf(buf, PAGE_SIZE, "%u\n", state->forecast);
+}
+
+static ssize_t show_forecast_stats(const struct cluster_data *state, char *buf)
+{
+	ssize_t count;
+
+	spin_lock_irq(&state_lock);
+	count = scnprintf(buf, PAGE_SIZE,
+			  "forecast_need: %u\nhits: %llu\nmisses: %llu\nexcess_cpus: %llu\n"
+			  "unpause_lat_us: %llu\nunpause_lat_max_us: %llu\n",
+			  state->forecast_need, state->forecast_hits,
+			  state->forecast_misses, state->forecast_excess,
+			  div_u64(state->unpause_lat_ns, NSEC_PER_USEC),
+			  div_u64(state->unpause_lat_max_ns, NSEC_PER_USEC));
+	spin_unlock_irq(&state_lock);
+
+	return count;
+}
+
 static ssize_t show_need_cpus(const struct cluster_data *state, char *buf)
 {
 	return scnprintf(buf, PAGE_SIZE, "%u\n", state->need_cpus);
@@ -582,6 +652,8 @@ core_ctl_attr_rw(nrrun_cpu_mask);
 core_ctl_attr_rw(nrrun_cpu_misfit_mask);
 core_ctl_attr_rw(assist_cpu_mask);
 core_ctl_attr_rw(assist_cpu_misfit_mask);
+core_ctl_attr_rw(forecast);
+core_ctl_attr_ro(forecast_stats);
 
 static struct attribute *default_attrs[] = {
 	&min_cpus.attr,
@@ -600,6 +672,8 @@ static struct attribute *default_attrs[] = {
 	&nrrun_cpu_misfit_mask.attr,
 	&assist_cpu_mask.attr,
 	&assist_cpu_misfit_mask.attr,
+	&forecast.attr,
+	&forecast_stats.attr,
 	NULL
 };
 ATTRIBUTE_GROUPS(default);
@@ -943,6 +1017,7 @@ static int compute_cluster_nr_busy(int index)
 	return nr_busy;
 }
 
+static void update_need_forecast(struct cluster_data *cluster);
 static void update_running_avg(u64 window_start, u32 wakeup_ctr_sum)
 {
 	struct cluster_data *cluster;
@@ -982,6 +1057,9 @@ static void update_running_avg(u64 window_start, u32 wakeup_ctr_sum)
 
 		cluster->nr_busy = compute_cluster_nr_busy(index);
 
+		if (cluster->forecast)
+			update_need_forecast(cluster);
+
 		trace_core_ctl_update_nr_need(cluster->first_cpu, nr_need,
 					nr_misfit_need, cluster->nrrun, cluster->max_nr,
 					cluster->strict_nrrun, nr_assist_need,
@@ -1039,6 +1117,64 @@ static unsigned int apply_task_need(const struct cluster_data *cluster)
 	return new_need;
 }
 
+/*
+ * Forecast the need of the next window from the history of apply_task_need(),
+ * so that CPUs are resumed before a burst instead of one window into it.
+ *
+ * Two patterns are anticipated: a need that rose in this window keeps rising
+ * by the same step, and bursts which started the same number of windows apart
+ * twice in a row start again after that period, with the peak need of the
+ * last burst. The forecast made for this window is scored against the need
+ * actually seen, but only if either of them rose above the last window's
+ * need: a hit had all the CPUs ready, excess_cpus counts the ones resumed
+ * for nothing. Idle or steady windows, which any forecast gets right, are
+ * not scored.
+ *
+ * Must be called with state_lock held.
+ */
+static void update_need_forecast(struct cluster_data *cluster)
+{
+	unsigned int need = apply_task_need(cluster);
+	unsigned int last = cluster->last_task_need;
+	unsigned int forecast = need;
+	u64 period;
+
+	if (cluster->nr_windows &&
+	    (need > last || cluster->forecast_need > last)) {
+		if (need <= cluster->forecast_need) {
+			cluster->forecast_hits++;
+			cluster->forecast_excess += cluster->forecast_need - need;
+		} else {
+			cluster->forecast_misses++;
+		}
+	}
+	cluster->nr_windows++;
+
+	if (need > last && !cluster->rising) {
+		/* a new burst starts */
+		if (cluster->burst_window) {
+			period = cluster->nr_windows - cluster->burst_window;
+			cluster->burst_period_stable = period == cluster->burst_period;
+			cluster->burst_period = min_t(u64, period, UINT_MAX);
+		}
+		cluster->burst_window = cluster->nr_windows;
+		cluster->burst_need = need;
+	} else {
+		cluster->burst_need = max(cluster->burst_need, need);
+	}
+	cluster->rising = need > last;
+
+	if (need > last)
+		forecast = need + (need - last);
+
+	if (cluster->burst_period_stable && cluster->burst_period > 1 &&
+	    cluster->nr_windows + 1 - cluster->burst_window == cluster->burst_period)
+		forecast = max(forecast, cluster->burst_need);
+
+	cluster->forecast_need = min(forecast, cluster->num_cpus);
+	cluster->last_task_need = need;
+}
+
 /* ======================= load based core count  ====================== */
 
 static unsigned int apply_limits(const struct cluster_data *cluster,
@@ -1101,10 +1237,13 @@ static bool eval_need(struct cluster_data *cluster)
 
 	spin_lock_irqsave(&state_lock, flags);
 
-	if (cluster->boost || !cluster->enable)
+	if (cluster->boost || !cluster->enable) {
 		need_cpus = cluster->max_cpus;
-	else
+	} else {
 		need_cpus = apply_task_need(cluster);
+		if (cluster->forecast)
+			need_cpus = max(need_cpus, cluster->forecast_need);
+	}
 
 	new_need = apply_limits(cluster, need_cpus);
 
@@ -1135,6 +1274,11 @@ static bool eval_need(struct cluster_data *cluster)
 		cluster->need_cpus = new_need;
 	}
 
+	if (new_need <= cluster->active_cpus)
+		cluster->unpause_req_ns = 0;
+	else if (adj_now && adj_possible && !cluster->unpause_req_ns)
+		cluster->unpause_req_ns = ktime_get_ns();
+
 unlock:
 	trace_core_ctl_eval_need(cluster->first_cpu, last_need, new_need,
 				 cluster->active_cpus, adj_now, adj_possible,
@@ -1689,6 +1833,32 @@ static void core_ctl_resume_cpus(struct cpumask *cpus_to_unpause,
 	}
 }
 
+/* account the time from eval_need() asking for more CPUs until resuming them */
+static void update_unpause_latency(const struct cpumask *unpaused,
+				   const struct cpumask *part_unpaused)
+{
+	struct cluster_data *cluster;
+	unsigned int index = 0;
+	unsigned long flags;
+	u64 now = ktime_get_ns();
+
+	spin_lock_irqsave(&state_lock, flags);
+	for_each_cluster(cluster, index) {
+		if (!cluster->unpause_req_ns)
+			continue;
+
+		if (!cpumask_intersects(&cluster->cpu_mask, unpaused) &&
+		    !cpumask_intersects(&cluster->cpu_mask, part_unpaused))
+			continue;
+
+		cluster->unpause_lat_ns = now - cluster->unpause_req_ns;
+		cluster->unpause_lat_max_ns = max(cluster->unpause_lat_max_ns,
+						  cluster->unpause_lat_ns);
+		cluster->unpause_req_ns = 0;
+	}
+	spin_unlock_irqrestore(&state_lock, flags);
+}
+
 static void __ref do_core_ctl(void)
 {
 	struct cluster_data *cluster;
@@ -1720,6 +1890,7 @@ static void __ref do_core_ctl(void)
 
 	core_ctl_pause_cpus(&cpus_to_pause, &cpus_to_part_pause);
 	core_ctl_resume_cpus(&cpus_to_unpause, &cpus_to_part_unpause);
+	update_unpause_latency(&cpus_to_unpause, &cpus_to_part_unpause);
 }
 
 static int __ref try_core_ctl(void *data)
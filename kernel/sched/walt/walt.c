@@ -1569,33 +1569,36 @@ static void rollover_top_tasks(struct rq *rq, bool full_window)
 	wrq->curr_top = 0;
 }
 
-static u32 empty_windows[WALT_NR_CPUS];
-
 static void rollover_task_window(struct task_struct *p, bool full_window)
 {
-	u32 *curr_cpu_windows = empty_windows;
-	u32 curr_window;
-	int i;
 	struct walt_rq *wrq = &per_cpu(walt_rq, cpu_of(task_rq(p)));
 	struct walt_task_struct *wts = (struct walt_task_struct *) p->android_vendor_data1;
 
-	/* Rollover the sum */
-	curr_window = 0;
+	/*
+	 * The sums cover all per-CPU entries, so a task which didn't run in
+	 * either window (most of them on a system with many threads) has
+	 * nothing to roll over.
+	 */
+	if (!wts->curr_window && !wts->prev_window)
+		goto out;
 
-	if (!full_window) {
-		curr_window = wts->curr_window;
-		curr_cpu_windows = wts->curr_window_cpu;
+	/*
+	 * Roll over the sum and the individual CPU contributions. The arrays
+	 * are copied and cleared whole, which takes a few wide stores rather
+	 * than a loop over nr_cpu_ids; entries past nr_cpu_ids are always 0.
+	 */
+	if (full_window) {
+		wts->prev_window = 0;
+		memset(wts->prev_window_cpu, 0, sizeof(wts->prev_window_cpu));
+	} else {
+		wts->prev_window = wts->curr_window;
+		memcpy(wts->prev_window_cpu, wts->curr_window_cpu,
+		       sizeof(wts->prev_window_cpu));
 	}
-
-	wts->prev_window = curr_window;
 	wts->curr_window = 0;
+	memset(wts->curr_window_cpu, 0, sizeof(wts->curr_window_cpu));
 
-	/* Roll over individual CPU contributions */
-	for (i = 0; i < nr_cpu_ids; i++) {
-		wts->prev_window_cpu[i] = curr_cpu_windows[i];
-		wts->curr_window_cpu[i] = 0;
-	}
-
+out:
 	if (is_new_task(p))
 		wts->active_time += wrq->prev_window_size;
 }
@@ -2615,6 +2618,7 @@ static void init_clusters(void)
 {
 	init_cluster.cpus = *cpu_possible_mask;
 	raw_spin_lock_init(&init_cluster.load_lock);
+	raw_spin_lock_init(&init_cluster.lb_migration_lock);
 	INIT_LIST_HEAD(&cluster_head);
 	list_add(&init_cluster.list, &cluster_head);
 }
@@ -2648,6 +2652,7 @@ static struct walt_sched_cluster *alloc_new_cluster(const struct cpumask *cpus)
 	cluster->max_possible_freq	=	1;
 
 	raw_spin_lock_init(&cluster->load_lock);
+	raw_spin_lock_init(&cluster->lb_migration_lock);
 	cluster->cpus			= *cpus;
 	cluster->found_ts		= 0;
 
@@ -5143,6 +5148,8 @@ static void android_rvh_enqueue_task(void *unused, struct rq *rq,
 	if (!double_enqueue)
 		walt_inc_cumulative_runnable_avg(rq, p);
 
+	walt_lb_update_cluster_summary(rq, 1);
+
 #if IS_ENABLED(CONFIG_OPLUS_CPUFREQ_IOWAIT_PROTECT)
 	if ((flags & ENQUEUE_WAKEUP) && do_pl_notif(rq, in_iowait)) {
 		if (in_iowait)
@@ -5205,6 +5212,8 @@ static void android_rvh_dequeue_task(void *unused, struct rq *rq,
 	if (!double_dequeue)
 		walt_dec_cumulative_runnable_avg(rq, p);
 
+	walt_lb_update_cluster_summary(rq, -1);
+
 	trace_sched_enq_deq_task(p, 0, cpumask_bits(p->cpus_ptr)[0], is_mvp(wts));
 }
 
@@ -5242,6 +5251,7 @@ static void android_rvh_update_misfit_status(void *unused, struct task_struct *p
 		wts->misfit = misfit;
 		wrq->walt_stats.nr_big_tasks += change;
 		BUG_ON(wrq->walt_stats.nr_big_tasks < 0);
+		walt_lb_update_cluster_summary(rq, 0);
 	}
 }
 
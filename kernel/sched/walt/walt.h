@@ -186,6 +186,16 @@ struct walt_sched_cluster {
 	u64			aggr_grp_load;
 	unsigned long		util_to_cost[1024];
 	u64			found_ts;
+
+	/*
+	 * Load balance summary, kept up to date at enqueue/dequeue and tick.
+	 * A CPU in neither mask can't be picked as the busiest one, so a
+	 * cluster without any is skipped without looking at its runqueues.
+	 */
+	cpumask_t		lb_busy_cpus;	/* nr_running >= 2 */
+	cpumask_t		lb_misfit_cpus;	/* nr_big_tasks > 0 */
+	/* serializes active migrations of misfit tasks out of this cluster */
+	raw_spinlock_t		lb_migration_lock;
 };
 
 struct freq_relation_map {
@@ -326,6 +336,30 @@ static inline struct walt_sched_cluster *cpu_cluster(int cpu)
 	return wrq->cluster;
 }
 
+/* @enq is the change to rq->nr_running that is about to happen */
+static inline void walt_lb_update_cluster_summary(struct rq *rq, int enq)
+{
+	struct walt_rq *wrq = &per_cpu(walt_rq, cpu_of(rq));
+	struct walt_sched_cluster *cluster = wrq->cluster;
+	int cpu = cpu_of(rq);
+	bool busy = rq->nr_running + enq >= 2;
+	bool misfit = wrq->walt_stats.nr_big_tasks > 0;
+
+	/* the masks are shared within the cluster, only write on a change */
+	if (busy != cpumask_test_cpu(cpu, &cluster->lb_busy_cpus)) {
+		if (busy)
+			cpumask_set_cpu(cpu, &cluster->lb_busy_cpus);
+		else
+			cpumask_clear_cpu(cpu, &cluster->lb_busy_cpus);
+	}
+	if (misfit != cpumask_test_cpu(cpu, &cluster->lb_misfit_cpus)) {
+		if (misfit)
+			cpumask_set_cpu(cpu, &cluster->lb_misfit_cpus);
+		else
+			cpumask_clear_cpu(cpu, &cluster->lb_misfit_cpus);
+	}
+}
+
 static inline u32 cpu_cycles_to_freq(u64 cycles, u64 period)
 {
 	return div64_u64(cycles, period);
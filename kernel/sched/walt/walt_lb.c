@@ -668,8 +668,18 @@ static int walt_lb_find_busiest_cpu(int dst_cpu, const cpumask_t *src_mask, int
 				    bool is_newidle)
 {
 	int fsrc_cpu = cpumask_first(src_mask);
+	struct walt_sched_cluster *cluster = cpu_cluster(fsrc_cpu);
 	int busiest_cpu;
 
+	/*
+	 * All of the helpers below skip CPUs with a single runnable task
+	 * and no misfit task, so don't walk the runqueues of a cluster
+	 * that has none of the others.
+	 */
+	if (!cpumask_intersects(src_mask, &cluster->lb_busy_cpus) &&
+	    !cpumask_intersects(src_mask, &cluster->lb_misfit_cpus))
+		return -1;
+
 	if (check_for_higher_capacity(dst_cpu, fsrc_cpu))
 		busiest_cpu = walt_lb_find_busiest_from_lower_cap_cpu(dst_cpu,
 								src_mask, has_misfit, is_newidle);
@@ -683,13 +693,14 @@ static int walt_lb_find_busiest_cpu(int dst_cpu, const cpumask_t *src_mask, int
 	return busiest_cpu;
 }
 
-static DEFINE_RAW_SPINLOCK(walt_lb_migration_lock);
+static DEFINE_RAW_SPINLOCK(walt_lb_rotation_lock);
 void walt_lb_tick(struct rq *rq)
 {
 	int prev_cpu = rq->cpu, new_cpu, ret;
 	struct task_struct *p = rq->curr;
 	unsigned long flags;
 	struct walt_rq *prev_wrq = &per_cpu(walt_rq, cpu_of(rq));
+	raw_spinlock_t *migration_lock = &prev_wrq->cluster->lb_migration_lock;
 	struct walt_task_struct *wts = (struct walt_task_struct *) p->android_vendor_data1;
 #if IS_ENABLED(CONFIG_OPLUS_FEATURE_FRAME_BOOST)
 	bool need_up_migrate = false;
@@ -708,6 +719,8 @@ void walt_lb_tick(struct rq *rq)
 	raw_spin_lock(&rq->__lock);
 	if (available_idle_cpu(prev_cpu) && is_reserved(prev_cpu) && !rq->active_balance)
 		clear_reserved(prev_cpu);
+	/* catch up with nr_running changes made without an enqueue/dequeue */
+	walt_lb_update_cluster_summary(rq, 0);
 	raw_spin_unlock(&rq->__lock);
 
 	if (!walt_fair_task(p))
@@ -729,13 +742,22 @@ void walt_lb_tick(struct rq *rq)
 	if (READ_ONCE(p->__state) != TASK_RUNNING || p->nr_cpus_allowed == 1)
 		return;
 
-	raw_spin_lock_irqsave(&walt_lb_migration_lock, flags);
-
+	/* rotation pairs CPUs across all clusters */
 	if (walt_rotation_enabled) {
+		raw_spin_lock_irqsave(&walt_lb_rotation_lock, flags);
 		walt_lb_check_for_rotation(rq);
-		goto out_unlock;
+		raw_spin_unlock_irqrestore(&walt_lb_rotation_lock, flags);
+		return;
 	}
 
+	/*
+	 * Misfit tasks of one cluster mostly compete for the same bigger
+	 * CPUs, so serialize them to let each one see the CPUs reserved by
+	 * the others. Pulls out of different clusters only meet if they pick
+	 * the same CPU, which mark_reserved() settles below.
+	 */
+	raw_spin_lock_irqsave(migration_lock, flags);
+
 	rcu_read_lock();
 	new_cpu = walt_find_energy_efficient_cpu(p, prev_cpu, 0, 1);
 	rcu_read_unlock();
@@ -751,7 +773,7 @@ void walt_lb_tick(struct rq *rq)
 		goto out_unlock;
 
 	raw_spin_lock(&rq->__lock);
-	if (rq->active_balance) {
+	if (rq->active_balance || mark_reserved(new_cpu)) {
 		raw_spin_unlock(&rq->__lock);
 		goto out_unlock;
 	}
@@ -761,8 +783,7 @@ void walt_lb_tick(struct rq *rq)
 	prev_wrq->push_task = p;
 	raw_spin_unlock(&rq->__lock);
 
-	mark_reserved(new_cpu);
-	raw_spin_unlock_irqrestore(&walt_lb_migration_lock, flags);
+	raw_spin_unlock_irqrestore(migration_lock, flags);
 
 	trace_walt_active_load_balance(p, prev_cpu, new_cpu, wts);
 	ret = stop_one_cpu_nowait(prev_cpu,
@@ -776,7 +797,7 @@ void walt_lb_tick(struct rq *rq)
 	return;
 
 out_unlock:
-	raw_spin_unlock_irqrestore(&walt_lb_migration_lock, flags);
+	raw_spin_unlock_irqrestore(migration_lock, flags);
 }
 
 static inline int has_pushable_tasks(struct rq *rq)
@@ -857,19 +878,12 @@ static bool walt_balance_rt(struct rq *this_rq)
 __read_mostly unsigned int sysctl_sched_force_lb_enable = 1;
 static bool should_help_min_cap(int this_cpu)
 {
-	int cpu;
+	int cpu = cpumask_first(&cpu_array[0][0]);
 
 	if (!sysctl_sched_force_lb_enable || is_min_possible_cluster_cpu(this_cpu))
 		return false;
 
-	for_each_cpu(cpu, &cpu_array[0][0]) {
-		struct walt_rq *wrq = &per_cpu(walt_rq, cpu);
-
-		if (wrq->walt_stats.nr_big_tasks)
-			return true;
-	}
-
-	return false;
+	return !cpumask_empty(&cpu_cluster(cpu)->lb_misfit_cpus);
 }
 
 /* similar to sysctl_sched_migration_cost */
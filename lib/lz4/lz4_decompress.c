@@ -437,8 +437,19 @@ static FORCE_INLINE int LZ4_decompress_generic(
 				*op++ = *match++;
 		} else {
 			LZ4_copy8(op, match);
+#ifdef LZ4_DECOMPRESS_NEON
+			if (length > 16) {
+				/* a long match far enough behind, 16 bytes/step */
+				if (offset >= 16 &&
+				    cpy <= oend - WILDCOPY16LENGTH)
+					LZ4_wildCopy16(op + 8, match + 8, cpy);
+				else
+					LZ4_wildCopy(op + 8, match + 8, cpy);
+			}
+#else
 			if (length > 16)
 				LZ4_wildCopy(op + 8, match + 8, cpy);
+#endif
 		}
 		op = cpy; /* wildcopy correction */
 	}
@@ -457,9 +468,60 @@ static FORCE_INLINE int LZ4_decompress_generic(
 	return (int) (-(((const char *)ip) - src)) - 1;
 }
 
+#ifndef LZ4_DECOMPRESS_NEON
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON) && !defined(STATIC)
+#include <asm/neon.h>
+#include <asm/simd.h>
+
+/* bounds the time spent with preemption off in kernel_neon_begin() */
+#define LZ4_NEON_MAX_OUTPUT (64 * KB)
+
+static bool lz4_simd = true;
+module_param_named(simd, lz4_simd, bool, 0644);
+MODULE_PARM_DESC(simd, "Decompress with NEON when it can be used");
+
+static bool LZ4_use_neon(int outputSize)
+{
+	return READ_ONCE(lz4_simd) && outputSize <= LZ4_NEON_MAX_OUTPUT &&
+	       may_use_simd();
+}
+
+static int LZ4_decompress_neon(const char *src, char *dst,
+	int compressedSize, int dstCapacity, bool partial)
+{
+	int ret;
+
+	kernel_neon_begin();
+	if (partial)
+		ret = LZ4_decompress_safe_partial_neon(src, dst,
+						       compressedSize,
+						       dstCapacity);
+	else
+		ret = LZ4_decompress_safe_neon(src, dst, compressedSize,
+					       dstCapacity);
+	kernel_neon_end();
+	return ret;
+}
+#else
+static bool LZ4_use_neon(int outputSize)
+{
+	return false;
+}
+
+static int LZ4_decompress_neon(const char *src, char *dst,
+	int compressedSize, int dstCapacity, bool partial)
+{
+	return -1;
+}
+#endif
+
 int LZ4_decompress_safe(const char *source, char *dest,
 	int compressedSize, int maxDecompressedSize)
 {
+	if (LZ4_use_neon(maxDecompressedSize))
+		return LZ4_decompress_neon(source, dest, compressedSize,
+					   maxDecompressedSize, false);
+
 	return LZ4_decompress_generic(source, dest,
 				      compressedSize, maxDecompressedSize,
 				      endOnInputSize, decode_full_block,
@@ -470,6 +532,10 @@ int LZ4_decompress_safe_partial(const char *src, char *dst,
 	int compressedSize, int targetOutputSize, int dstCapacity)
 {
 	dstCapacity = min(targetOutputSize, dstCapacity);
+	if (LZ4_use_neon(dstCapacity))
+		return LZ4_decompress_neon(src, dst, compressedSize,
+					   dstCapacity, true);
+
 	return LZ4_decompress_generic(src, dst, compressedSize, dstCapacity,
 				      endOnInputSize, partial_decode,
 				      noDict, (BYTE *)dst, NULL, 0);
@@ -718,3 +784,4 @@ EXPORT_SYMBOL(LZ4_decompress_fast_usingDict);
 MODULE_LICENSE("Dual BSD/GPL");
 MODULE_DESCRIPTION("LZ4 decompressor");
 #endif
+#endif /* LZ4_DECOMPRESS_NEON */
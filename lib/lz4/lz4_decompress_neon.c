@@ -0,0 +1,32 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * LZ4_decompress_generic() built with NEON enabled, so long matches are
+ * copied with 16-byte vector loads and stores. Only called by
+ * LZ4_decompress_safe() and LZ4_decompress_safe_partial() between
+ * kernel_neon_begin() and kernel_neon_end().
+ */
+
+#define LZ4_DECOMPRESS_NEON
+#include "lz4_decompress.c"
+
+int LZ4_decompress_safe_neon(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize)
+{
+	return LZ4_decompress_generic(source, dest,
+				      compressedSize, maxDecompressedSize,
+				      endOnInputSize, decode_full_block,
+				      noDict, (BYTE *)dest, NULL, 0);
+}
+EXPORT_SYMBOL_GPL(LZ4_decompress_safe_neon);
+
+int LZ4_decompress_safe_partial_neon(const char *src, char *dst,
+	int compressedSize, int dstCapacity)
+{
+	return LZ4_decompress_generic(src, dst, compressedSize, dstCapacity,
+				      endOnInputSize, partial_decode,
+				      noDict, (BYTE *)dst, NULL, 0);
+}
+EXPORT_SYMBOL_GPL(LZ4_decompress_safe_partial_neon);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("LZ4 decompressor, NEON build");
@@ -80,6 +80,7 @@ typedef uintptr_t uptrval;
  * without overflowing output buffer
  */
 #define MATCH_SAFEGUARD_DISTANCE  ((2 * WILDCOPYLENGTH) - MINMATCH)
+#define WILDCOPY16LENGTH 16
 
 /* Increase this value ==> compression run slower on incompressible data */
 #define LZ4_SKIPTRIGGER 6
@@ -181,6 +182,36 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	} while (d < e);
 }
 
+#ifdef LZ4_DECOMPRESS_NEON
+#include <arm_neon.h>
+
+/*
+ * same as LZ4_wildCopy() but 16 bytes per step with NEON loads and stores,
+ * only built into lz4_decompress_neon.c. It can overwrite up to 15 bytes
+ * beyond dstEnd, and src must be at least 16 bytes behind dst if they
+ * overlap.
+ */
+static FORCE_INLINE void LZ4_wildCopy16(void *dstPtr,
+	const void *srcPtr, void *dstEnd)
+{
+	BYTE *d = (BYTE *)dstPtr;
+	const BYTE *s = (const BYTE *)srcPtr;
+	BYTE *const e = (BYTE *)dstEnd;
+
+	do {
+		vst1q_u8(d, vld1q_u8(s));
+		d += 16;
+		s += 16;
+	} while (d < e);
+}
+#endif
+
+/* the NEON build of LZ4_decompress_generic(), see lz4_decompress_neon.c */
+int LZ4_decompress_safe_neon(const char *source, char *dest,
+	int compressedSize, int maxDecompressedSize);
+int LZ4_decompress_safe_partial_neon(const char *src, char *dst,
+	int compressedSize, int dstCapacity);
+
 static FORCE_INLINE unsigned int LZ4_NbCommonBytes(register size_t val)
 {
 #if LZ4_LITTLE_ENDIAN
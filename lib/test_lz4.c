@@ -0,0 +1,201 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test cases and throughput benchmark for the LZ4 decompressor.
+ *
+ * Every sample is compressed with LZ4_compress_default() and decompressed
+ * again, fully and partially, into a buffer with a guard area behind it.
+ * Samples cover the match offsets and lengths which take different copy
+ * paths in LZ4_decompress_generic(). With bench_ms set, decompression
+ * throughput of each sample is reported as well; on arm64, running it
+ * again with lz4_decompress.simd=0 gives the scalar numbers to compare.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define TEST_LZ4_SIZE		(64 * 1024)
+#define TEST_LZ4_GUARD		64
+#define TEST_LZ4_GUARD_BYTE	0xa5
+
+static unsigned int bench_ms;
+module_param(bench_ms, uint, 0444);
+MODULE_PARM_DESC(bench_ms, "Time to decompress each sample for, 0 to skip");
+
+static unsigned int failed_tests, total_tests;
+
+/* repeat @period bytes of noise, i.e. matches at offset @period */
+static void __init fill_period(u8 *buf, unsigned int len, unsigned int period)
+{
+	unsigned int i;
+
+	prandom_bytes(buf, min(period, len));
+	for (i = period; i < len; ++i)
+		buf[i] = buf[i - period];
+}
+
+/* runs of random length copied from random earlier offsets */
+static void __init fill_mixed(u8 *buf, unsigned int len)
+{
+	unsigned int i = 0;
+
+	while (i < len) {
+		unsigned int run = 1 + prandom_u32_max(300);
+		unsigned int off = 1 + prandom_u32_max(min(i + 1, 4096U));
+
+		run = min(run, len - i);
+		if (off > i || !prandom_u32_max(4)) {
+			prandom_bytes(buf + i, run);
+			i += run;
+			continue;
+		}
+		while (run--) {
+			buf[i] = buf[i - off];
+			++i;
+		}
+	}
+}
+
+static int __init check_decompress(const char *name, const u8 *orig,
+				   const u8 *comp, int clen, u8 *out,
+				   int target)
+{
+	int ret, i;
+
+	++total_tests;
+	memset(out, TEST_LZ4_GUARD_BYTE, TEST_LZ4_SIZE + TEST_LZ4_GUARD);
+	if (target == TEST_LZ4_SIZE)
+		ret = LZ4_decompress_safe(comp, out, clen, TEST_LZ4_SIZE);
+	else
+		ret = LZ4_decompress_safe_partial(comp, out, clen, target,
+						  target);
+	if (ret != target || memcmp(orig, out, target)) {
+		pr_err("%s: decompressing %d bytes returned %d or bad data\n",
+		       name, target, ret);
+		++failed_tests;
+		return -EINVAL;
+	}
+	for (i = target; i < TEST_LZ4_SIZE + TEST_LZ4_GUARD; ++i) {
+		if (out[i] != TEST_LZ4_GUARD_BYTE) {
+			pr_err("%s: decompressing %d bytes wrote at %d\n",
+			       name, target, i);
+			++failed_tests;
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static void __init bench_decompress(const char *name, const u8 *comp,
+				    int clen, u8 *out)
+{
+	ktime_t start = ktime_get(), end;
+	u64 loops = 0, ns;
+
+	end = ktime_add_ms(start, bench_ms);
+	do {
+		LZ4_decompress_safe(comp, out, clen, TEST_LZ4_SIZE);
+		++loops;
+		cond_resched();
+	} while (ktime_before(ktime_get(), end));
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	/* bytes per microsecond, i.e. MB/s */
+	pr_info("%s: ratio %d%%, %llu MB/s\n", name,
+		clen * 100 / TEST_LZ4_SIZE,
+		div64_u64(loops * TEST_LZ4_SIZE * NSEC_PER_USEC, ns));
+}
+
+static void __init test_sample(const char *name, const u8 *orig, u8 *comp,
+			       u8 *out, void *wrkmem)
+{
+	static const int targets[] __initconst = {
+		1, 17, 4095, 4096, 4097, 32768 + 3, TEST_LZ4_SIZE - 1,
+	};
+	int clen, i;
+
+	clen = LZ4_compress_default(orig, comp, TEST_LZ4_SIZE,
+				    LZ4_compressBound(TEST_LZ4_SIZE), wrkmem);
+	if (clen <= 0) {
+		pr_err("%s: compression failed\n", name);
+		++failed_tests;
+		return;
+	}
+
+	if (check_decompress(name, orig, comp, clen, out, TEST_LZ4_SIZE))
+		return;
+	for (i = 0; i < ARRAY_SIZE(targets); ++i)
+		check_decompress(name, orig, comp, clen, out, targets[i]);
+
+	if (bench_ms)
+		bench_decompress(name, comp, clen, out);
+}
+
+static int __init test_lz4_init(void)
+{
+	static const unsigned int periods[] __initconst = {
+		1, 2, 3, 4, 7, 8, 9, 15, 16, 17, 31, 64, 1000,
+	};
+	u8 *orig, *comp, *out;
+	void *wrkmem;
+	char name[32];
+	int i;
+
+	orig = vmalloc(TEST_LZ4_SIZE);
+	comp = vmalloc(LZ4_compressBound(TEST_LZ4_SIZE));
+	out = vmalloc(TEST_LZ4_SIZE + TEST_LZ4_GUARD);
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!orig || !comp || !out || !wrkmem) {
+		vfree(orig);
+		vfree(comp);
+		vfree(out);
+		vfree(wrkmem);
+		return -ENOMEM;
+	}
+
+	memset(orig, 0, TEST_LZ4_SIZE);
+	test_sample("zeroes", orig, comp, out, wrkmem);
+
+	for (i = 0; i < ARRAY_SIZE(periods); ++i) {
+		snprintf(name, sizeof(name), "period %u", periods[i]);
+		fill_period(orig, TEST_LZ4_SIZE, periods[i]);
+		test_sample(name, orig, comp, out, wrkmem);
+	}
+
+	fill_mixed(orig, TEST_LZ4_SIZE);
+	test_sample("mixed", orig, comp, out, wrkmem);
+
+	prandom_bytes(orig, TEST_LZ4_SIZE);
+	test_sample("random", orig, comp, out, wrkmem);
+
+	vfree(orig);
+	vfree(comp);
+	vfree(out);
+	vfree(wrkmem);
+
+	if (failed_tests) {
+		pr_err("failed %u out of %u tests\n", failed_tests,
+		       total_tests);
+		return -EINVAL;
+	}
+	pr_info("all %u tests passed\n", total_tests);
+	return 0;
+}
+
+static void __exit test_lz4_exit(void)
+{
+}
+
+module_init(test_lz4_init);
+module_exit(test_lz4_exit);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,184 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Benchmark of the scheduler overhead of many periodically waking threads.
+ *
+ * One busy thread per online CPU counts loops of fixed work for bench_ms,
+ * first on an idle system and then while @threads threads each wake every
+ * @period_ms to do a little work and sleep again. With the default period a
+ * bit over the 20ms WALT window, nearly every wakeup finds its task in a new
+ * window, so the per-task window rollover runs on every enqueue. The loss
+ * of busy loops, the wakeups per second and the mean wakeup latency are
+ * reported; comparing kernels shows the cost of the wakeup path per task.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/delay.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+
+static unsigned int bench_ms = 5000;
+module_param(bench_ms, uint, 0444);
+MODULE_PARM_DESC(bench_ms, "Time to run the busy threads for, in each phase");
+
+static unsigned int threads = 2048;
+module_param(threads, uint, 0444);
+MODULE_PARM_DESC(threads, "Periodically waking threads");
+
+static unsigned int period_ms = 25;
+module_param(period_ms, uint, 0444);
+MODULE_PARM_DESC(period_ms, "Time each waking thread sleeps for");
+
+struct test_busy_worker {
+	u64 loops;
+	struct completion done;
+};
+
+static atomic64_t test_wakeups, test_wakeup_ns;
+
+static noinline u64 busy_work(u64 seed)
+{
+	unsigned int i;
+
+	for (i = 0; i < 1000; ++i)
+		seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+	return seed;
+}
+
+static int busy_worker(void *data)
+{
+	struct test_busy_worker *w = data;
+	ktime_t end = ktime_add_ms(ktime_get(), bench_ms);
+	u64 seed = 0;
+
+	do {
+		seed = busy_work(seed);
+		++w->loops;
+		cond_resched();
+	} while (ktime_before(ktime_get(), end));
+
+	/* keep the work from being optimized away */
+	if (seed == 1)
+		pr_info("seed %llu\n", seed);
+	complete(&w->done);
+	return 0;
+}
+
+static int sleep_worker(void *data)
+{
+	ktime_t due;
+	s64 delay;
+
+	while (!kthread_should_stop()) {
+		due = ktime_add_ms(ktime_get(), period_ms);
+		set_current_state(TASK_INTERRUPTIBLE);
+		/* woken early by kthread_stop() */
+		if (schedule_hrtimeout(&due, HRTIMER_MODE_ABS))
+			continue;
+
+		delay = ktime_to_ns(ktime_sub(ktime_get(), due));
+		atomic64_inc(&test_wakeups);
+		atomic64_add(max_t(s64, delay, 0), &test_wakeup_ns);
+		busy_work(0);
+	}
+	return 0;
+}
+
+/* Returns the loops of all busy threads, or 0 if they couldn't be run */
+static u64 __init run_busy(void)
+{
+	unsigned int nr = num_online_cpus(), i = 0, cpu;
+	struct test_busy_worker *workers;
+	struct task_struct *task;
+	u64 loops = 0;
+
+	workers = kcalloc(nr, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return 0;
+
+	for_each_online_cpu(cpu) {
+		if (i == nr)
+			break;
+		init_completion(&workers[i].done);
+		task = kthread_create(busy_worker, &workers[i], "test_busy/%u",
+				      cpu);
+		if (IS_ERR(task))
+			break;
+		kthread_bind(task, cpu);
+		wake_up_process(task);
+		++i;
+	}
+	nr = i;
+	for (i = 0; i < nr; ++i) {
+		wait_for_completion(&workers[i].done);
+		loops += workers[i].loops;
+	}
+
+	kfree(workers);
+	return loops;
+}
+
+static int __init test_sched_wakeups_init(void)
+{
+	struct task_struct **sleepers;
+	u64 idle_loops, loops, wakeups;
+	unsigned int i, n;
+
+	if (!bench_ms || !period_ms)
+		return -EINVAL;
+
+	sleepers = kvcalloc(threads, sizeof(*sleepers), GFP_KERNEL);
+	if (!sleepers)
+		return -ENOMEM;
+
+	idle_loops = run_busy();
+	pr_info("idle: %llu loops/ms\n", div_u64(idle_loops, bench_ms));
+
+	for (n = 0; n < threads; ++n) {
+		sleepers[n] = kthread_run(sleep_worker, NULL, "test_sleep/%u",
+					  n);
+		if (IS_ERR(sleepers[n]))
+			break;
+	}
+	/* let every sleeper get through its first period */
+	msleep(period_ms * 2);
+
+	atomic64_set(&test_wakeups, 0);
+	atomic64_set(&test_wakeup_ns, 0);
+	loops = run_busy();
+	wakeups = atomic64_read(&test_wakeups);
+
+	for (i = 0; i < n; ++i)
+		kthread_stop(sleepers[i]);
+	kvfree(sleepers);
+
+	pr_info("%u threads waking every %ums: %llu loops/ms, %llu wakeups/s\n",
+		n, period_ms, div_u64(loops, bench_ms),
+		div_u64(wakeups * MSEC_PER_SEC, bench_ms));
+	if (wakeups)
+		pr_info("mean wakeup latency: %llu ns\n",
+			div64_u64(atomic64_read(&test_wakeup_ns), wakeups));
+	if (idle_loops > loops)
+		pr_info("busy loops lost: %llu per mille\n",
+			div64_u64((idle_loops - loops) * 1000, idle_loops));
+	return 0;
+}
+
+static void __exit test_sched_wakeups_exit(void)
+{
+}
+
+module_init(test_sched_wakeups_init);
+module_exit(test_sched_wakeups_exit);
+
+MODULE_LICENSE("GPL");
@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Swap slot allocation throughput benchmark.
+ *
+ * Every thread takes @window slots with get_swap_page(), as swapping out
+ * that many pages would, and gives them back with put_swap_page(), over
+ * and over for bench_ms. Slots per second are reported for one thread and
+ * for @threads threads at once, which contend on the swap_info lock
+ * whenever their slots caches are refilled or flushed. The first window
+ * of every thread is checked for duplicate slots. Swap must be on, with
+ * at least @window free slots per thread.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/completion.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/mm.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/swap.h>
+#include <linux/wait.h>
+
+static unsigned int bench_ms = 1000;
+module_param(bench_ms, uint, 0444);
+MODULE_PARM_DESC(bench_ms, "Time to allocate slots for with each thread count");
+
+static unsigned int threads = 8;
+module_param(threads, uint, 0444);
+MODULE_PARM_DESC(threads, "Threads for the parallel benchmark");
+
+static unsigned int window = 1024;
+module_param(window, uint, 0444);
+MODULE_PARM_DESC(window, "Slots each thread holds before giving them back");
+
+static unsigned int failed_tests, total_tests;
+
+struct test_swap_worker {
+	struct page *page;
+	swp_entry_t *entries;
+	u64 slots;
+	int err;
+	struct completion done;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(test_swap_start_wait);
+static bool test_swap_started;
+
+static int cmp_entry(const void *a, const void *b)
+{
+	const swp_entry_t *e1 = a, *e2 = b;
+
+	if (e1->val < e2->val)
+		return -1;
+	return e1->val > e2->val;
+}
+
+static bool has_duplicates(swp_entry_t *entries, unsigned int n)
+{
+	unsigned int i;
+
+	sort(entries, n, sizeof(*entries), cmp_entry, NULL);
+	for (i = 1; i < n; ++i) {
+		if (entries[i].val == entries[i - 1].val)
+			return true;
+	}
+	return false;
+}
+
+static int swap_worker(void *data)
+{
+	struct test_swap_worker *w = data;
+	bool checked = false;
+	unsigned int i, n;
+	ktime_t end;
+
+	wait_event(test_swap_start_wait, READ_ONCE(test_swap_started));
+	end = ktime_add_ms(ktime_get(), bench_ms);
+	do {
+		for (n = 0; n < window; ++n) {
+			w->entries[n] = get_swap_page(w->page);
+			if (!w->entries[n].val)
+				break;
+		}
+		if (!checked) {
+			checked = true;
+			if (n < window)
+				w->err = -ENOSPC;
+			else if (has_duplicates(w->entries, n))
+				w->err = -EINVAL;
+		}
+		for (i = 0; i < n; ++i)
+			put_swap_page(w->page, w->entries[i]);
+		w->slots += n;
+		cond_resched();
+	} while (!w->err && ktime_before(ktime_get(), end));
+
+	complete(&w->done);
+	return 0;
+}
+
+static void __init bench_slots(unsigned int nr_workers)
+{
+	struct test_swap_worker *workers;
+	struct task_struct *task;
+	unsigned int i, n;
+	u64 slots = 0;
+
+	workers = kcalloc(nr_workers, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return;
+	for (i = 0; i < nr_workers; ++i) {
+		workers[i].page = alloc_page(GFP_KERNEL);
+		workers[i].entries = kvcalloc(window, sizeof(swp_entry_t),
+					      GFP_KERNEL);
+		if (!workers[i].page || !workers[i].entries)
+			goto free;
+		init_completion(&workers[i].done);
+	}
+
+	WRITE_ONCE(test_swap_started, false);
+	for (n = 0; n < nr_workers; ++n) {
+		task = kthread_run(swap_worker, &workers[n], "test_swap/%u",
+				   n);
+		if (IS_ERR(task))
+			break;
+	}
+
+	WRITE_ONCE(test_swap_started, true);
+	wake_up_all(&test_swap_start_wait);
+	for (i = 0; i < n; ++i) {
+		wait_for_completion(&workers[i].done);
+		++total_tests;
+		if (workers[i].err) {
+			pr_err("thread %u: %s\n", i,
+			       workers[i].err == -ENOSPC ?
+			       "not enough free swap" : "duplicate slots");
+			++failed_tests;
+		}
+		slots += workers[i].slots;
+	}
+
+	pr_info("%u threads: %llu slots/s\n", n,
+		div_u64(slots * MSEC_PER_SEC, bench_ms));
+free:
+	for (i = 0; i < nr_workers; ++i) {
+		if (workers[i].page)
+			__free_page(workers[i].page);
+		kvfree(workers[i].entries);
+	}
+	kfree(workers);
+}
+
+static int __init test_swap_slots_init(void)
+{
+	if (!window)
+		return -EINVAL;
+	if (get_nr_swap_pages() <= 0)
+		return -ENODEV;
+
+	bench_slots(1);
+	if (threads > 1)
+		bench_slots(threads);
+
+	if (failed_tests) {
+		pr_err("failed %u out of %u tests\n", failed_tests,
+		       total_tests);
+		return -EINVAL;
+	}
+	pr_info("all %u tests passed\n", total_tests);
+	return 0;
+}
+
+static void __exit test_swap_slots_exit(void)
+{
+}
+
+module_init(test_swap_slots_init);
+module_exit(test_swap_slots_exit);
+
+MODULE_LICENSE("GPL");
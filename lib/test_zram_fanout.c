@@ -0,0 +1,252 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Write throughput benchmark for the compression fanout of zram.
+ *
+ * Write bios of bio_pages pages are submitted to a zram device whose
+ * disksize has been set, for bench_ms with max_comp_fanout at 1, so the
+ * submitter compresses every page itself, and then with it at @fanout.
+ * Each pass reports pages written per second, and the first bio it wrote
+ * is read back and checked. max_comp_fanout is restored afterwards.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/bio.h>
+#include <linux/blkdev.h>
+#include <linux/cpumask.h>
+#include <linux/fs.h>
+#include <linux/genhd.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/prandom.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+
+#define TEST_ZRAM_MODE		(FMODE_READ | FMODE_WRITE | FMODE_EXCL)
+
+static char *dev = "/dev/zram0";
+module_param(dev, charp, 0444);
+MODULE_PARM_DESC(dev, "zram device to write to, its disksize must be set");
+
+static unsigned int bench_ms = 1000;
+module_param(bench_ms, uint, 0444);
+MODULE_PARM_DESC(bench_ms, "Time to write for with each fanout");
+
+static unsigned int fanout;
+module_param(fanout, uint, 0444);
+MODULE_PARM_DESC(fanout, "Fanout to compare with 1, 0 for the online CPUs");
+
+static unsigned int bio_pages = 32;
+module_param(bio_pages, uint, 0444);
+MODULE_PARM_DESC(bio_pages, "Pages per write bio");
+
+static unsigned int failed_tests, total_tests;
+
+static int __init fanout_file(struct block_device *bdev, int flags,
+			      struct file **filp)
+{
+	char path[64];
+
+	snprintf(path, sizeof(path), "/sys/block/%s/max_comp_fanout",
+		 bdev->bd_disk->disk_name);
+	*filp = filp_open(path, flags, 0);
+	return PTR_ERR_OR_ZERO(*filp);
+}
+
+static int __init get_fanout(struct block_device *bdev, unsigned int *val)
+{
+	struct file *filp;
+	char buf[16] = {};
+	loff_t pos = 0;
+	ssize_t len;
+	int ret;
+
+	ret = fanout_file(bdev, O_RDONLY, &filp);
+	if (ret)
+		return ret;
+	len = kernel_read(filp, buf, sizeof(buf) - 1, &pos);
+	filp_close(filp, NULL);
+	if (len < 0)
+		return len;
+	return kstrtouint(buf, 10, val);
+}
+
+static int __init set_fanout(struct block_device *bdev, unsigned int val)
+{
+	struct file *filp;
+	char buf[16];
+	loff_t pos = 0;
+	ssize_t len;
+	int ret;
+
+	ret = fanout_file(bdev, O_WRONLY, &filp);
+	if (ret)
+		return ret;
+	len = scnprintf(buf, sizeof(buf), "%u\n", val);
+	len = kernel_write(filp, buf, len, &pos);
+	filp_close(filp, NULL);
+	return len < 0 ? len : 0;
+}
+
+static int __init submit_pages(struct block_device *bdev, struct page **pages,
+			       sector_t sector, unsigned int op)
+{
+	struct bio *bio;
+	unsigned int i;
+	int ret;
+
+	bio = bio_alloc(GFP_KERNEL, bio_pages);
+	bio_set_dev(bio, bdev);
+	bio->bi_iter.bi_sector = sector;
+	bio->bi_opf = op;
+	for (i = 0; i < bio_pages; ++i)
+		bio_add_page(bio, pages[i], PAGE_SIZE, 0);
+	ret = submit_bio_wait(bio);
+	bio_put(bio);
+	return ret;
+}
+
+static int __init check_pages(struct block_device *bdev, struct page **pages,
+			      struct page **out, unsigned int val)
+{
+	unsigned int i;
+	int ret;
+
+	++total_tests;
+	ret = submit_pages(bdev, out, 0, REQ_OP_READ);
+	if (ret) {
+		pr_err("max_comp_fanout %u: read failed: %d\n", val, ret);
+		++failed_tests;
+		return ret;
+	}
+	for (i = 0; i < bio_pages; ++i) {
+		if (memcmp(page_address(pages[i]), page_address(out[i]),
+			   PAGE_SIZE)) {
+			pr_err("max_comp_fanout %u: bad data in page %u\n",
+			       val, i);
+			++failed_tests;
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static int __init bench_write(struct block_device *bdev, struct page **pages,
+			      struct page **out, unsigned int val)
+{
+	sector_t nr_sectors = get_capacity(bdev->bd_disk);
+	sector_t bio_sectors = bio_pages << (PAGE_SHIFT - SECTOR_SHIFT);
+	sector_t sector = 0;
+	ktime_t start, end;
+	u64 loops = 0, ns;
+	int ret;
+
+	ret = set_fanout(bdev, val);
+	if (ret)
+		return ret;
+
+	start = ktime_get();
+	end = ktime_add_ms(start, bench_ms);
+	do {
+		ret = submit_pages(bdev, pages, sector, REQ_OP_WRITE);
+		if (ret) {
+			pr_err("max_comp_fanout %u: write failed: %d\n", val,
+			       ret);
+			return ret;
+		}
+		++loops;
+		sector += bio_sectors;
+		if (sector + bio_sectors > nr_sectors)
+			sector = 0;
+		cond_resched();
+	} while (ktime_before(ktime_get(), end));
+
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	pr_info("max_comp_fanout %u: %llu pages/s\n", val,
+		div64_u64(loops * bio_pages * NSEC_PER_SEC, ns));
+
+	return check_pages(bdev, pages, out, val);
+}
+
+static int __init test_zram_fanout_init(void)
+{
+	unsigned int nr_fanout = fanout ?: num_online_cpus();
+	struct page **pages, **out;
+	struct block_device *bdev;
+	unsigned int old, i;
+	int ret;
+
+	if (!bio_pages || bio_pages > BIO_MAX_PAGES)
+		return -EINVAL;
+
+	bdev = blkdev_get_by_path(dev, TEST_ZRAM_MODE, &failed_tests);
+	if (IS_ERR(bdev))
+		return PTR_ERR(bdev);
+
+	if (get_capacity(bdev->bd_disk) <
+	    bio_pages << (PAGE_SHIFT - SECTOR_SHIFT)) {
+		pr_err("%s is smaller than a bio, set its disksize\n", dev);
+		ret = -ENOSPC;
+		goto put;
+	}
+	ret = get_fanout(bdev, &old);
+	if (ret) {
+		pr_err("%s has no max_comp_fanout: %d\n", dev, ret);
+		goto put;
+	}
+
+	pages = kcalloc(bio_pages * 2, sizeof(*pages), GFP_KERNEL);
+	if (!pages) {
+		ret = -ENOMEM;
+		goto put;
+	}
+	out = pages + bio_pages;
+	for (i = 0; i < bio_pages * 2; ++i) {
+		pages[i] = alloc_page(GFP_KERNEL);
+		if (!pages[i]) {
+			ret = -ENOMEM;
+			goto free;
+		}
+	}
+	/* a random quarter, so the pages aren't same-filled */
+	for (i = 0; i < bio_pages; ++i) {
+		u8 *addr = page_address(pages[i]);
+
+		prandom_bytes(addr, PAGE_SIZE / 4);
+		memset(addr + PAGE_SIZE / 4, i, PAGE_SIZE - PAGE_SIZE / 4);
+	}
+
+	ret = bench_write(bdev, pages, out, 1);
+	if (!ret)
+		ret = bench_write(bdev, pages, out, nr_fanout);
+	set_fanout(bdev, old);
+
+free:
+	for (i = 0; i < bio_pages * 2 && pages[i]; ++i)
+		__free_page(pages[i]);
+	kfree(pages);
+put:
+	blkdev_put(bdev, TEST_ZRAM_MODE);
+	if (failed_tests) {
+		pr_err("failed %u out of %u tests\n", failed_tests,
+		       total_tests);
+		return -EINVAL;
+	}
+	if (ret)
+		return ret;
+
+	pr_info("all %u tests passed\n", total_tests);
+	return 0;
+}
+
+static void __exit test_zram_fanout_exit(void)
+{
+}
+
+module_init(test_zram_fanout_init);
+module_exit(test_zram_fanout_exit);
+
+MODULE_LICENSE("GPL");
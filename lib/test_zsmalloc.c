@@ -0,0 +1,220 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test cases and map/unmap throughput benchmark for zsmalloc.
+ *
+ * Objects of three quarters of a page are allocated from a new pool, so
+ * the zspages of their class are filled one after the other, in order:
+ * objects 0 and 3 of each zspage fit in a page, objects 1 and 2 span two
+ * pages. Every object is written and read back through zs_map_object().
+ * With bench_ms set, zs_map_object()/zs_unmap_object() throughput is
+ * reported for both kinds of object, from one thread and from @threads
+ * threads mapping objects of shared zspages at once. Only objects spanning
+ * two pages take the zspage migrate lock, so the two kinds show mapping
+ * with and without it.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
+
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/wait.h>
+#include <linux/zsmalloc.h>
+
+/* zs_malloc() stores the handle in front of the object */
+#define TEST_ZS_SIZE		(PAGE_SIZE * 3 / 4 - sizeof(unsigned long))
+#define TEST_ZS_OBJS_PER_ZSPAGE	4
+
+static unsigned int bench_ms;
+module_param(bench_ms, uint, 0444);
+MODULE_PARM_DESC(bench_ms, "Time to map each kind of object for, 0 to skip");
+
+static unsigned int threads;
+module_param(threads, uint, 0444);
+MODULE_PARM_DESC(threads, "Threads for the parallel benchmark, 0 for one per online CPU");
+
+static unsigned int failed_tests, total_tests;
+
+struct test_zs_worker {
+	struct zs_pool *pool;
+	unsigned long handle;
+	u64 loops;
+	struct completion done;
+};
+
+static DECLARE_WAIT_QUEUE_HEAD(test_zs_start_wait);
+static bool test_zs_started;
+
+static bool test_zs_spans(unsigned int i)
+{
+	unsigned int idx = i % TEST_ZS_OBJS_PER_ZSPAGE;
+
+	return idx == 1 || idx == 2;
+}
+
+static int __init check_object(struct zs_pool *pool, unsigned long handle,
+			       unsigned int i)
+{
+	u8 *addr;
+	int ret = 0;
+	size_t j;
+
+	++total_tests;
+	addr = zs_map_object(pool, handle, ZS_MM_WO);
+	for (j = 0; j < TEST_ZS_SIZE; ++j)
+		addr[j] = i + j;
+	zs_unmap_object(pool, handle);
+
+	addr = zs_map_object(pool, handle, ZS_MM_RO);
+	for (j = 0; j < TEST_ZS_SIZE; ++j) {
+		if (addr[j] != (u8)(i + j)) {
+			pr_err("object %u: bad data at %zu\n", i, j);
+			++failed_tests;
+			ret = -EINVAL;
+			break;
+		}
+	}
+	zs_unmap_object(pool, handle);
+	return ret;
+}
+
+static u64 bench_map(struct zs_pool *pool, unsigned long handle)
+{
+	ktime_t end = ktime_add_ms(ktime_get(), bench_ms);
+	u64 loops = 0;
+	u8 *addr;
+
+	do {
+		addr = zs_map_object(pool, handle, ZS_MM_RO);
+		(void)READ_ONCE(*addr);
+		zs_unmap_object(pool, handle);
+		if (!(++loops & 1023))
+			cond_resched();
+	} while ((loops & 1023) || ktime_before(ktime_get(), end));
+
+	return loops;
+}
+
+static int bench_worker(void *data)
+{
+	struct test_zs_worker *w = data;
+
+	wait_event(test_zs_start_wait, READ_ONCE(test_zs_started));
+	w->loops = bench_map(w->pool, w->handle);
+	complete(&w->done);
+	return 0;
+}
+
+/* every worker maps its own object, as the handle pin is exclusive */
+static void __init bench_parallel(struct zs_pool *pool,
+				  unsigned long *handles,
+				  unsigned int nr_workers, bool spans)
+{
+	struct test_zs_worker *workers;
+	struct task_struct *task;
+	unsigned int i, n = 0;
+	u64 loops = 0;
+
+	workers = kcalloc(nr_workers, sizeof(*workers), GFP_KERNEL);
+	if (!workers)
+		return;
+
+	WRITE_ONCE(test_zs_started, false);
+	for (i = 0; i < nr_workers * 2; ++i) {
+		if (test_zs_spans(i) != spans)
+			continue;
+		workers[n].pool = pool;
+		workers[n].handle = handles[i];
+		init_completion(&workers[n].done);
+		task = kthread_run(bench_worker, &workers[n], "test_zs/%u", n);
+		if (IS_ERR(task))
+			break;
+		++n;
+	}
+
+	WRITE_ONCE(test_zs_started, true);
+	wake_up_all(&test_zs_start_wait);
+	for (i = 0; i < n; ++i) {
+		wait_for_completion(&workers[i].done);
+		loops += workers[i].loops;
+	}
+	kfree(workers);
+
+	pr_info("%s, %u threads: %llu maps/ms\n",
+		spans ? "spanning two pages" : "within a page", n,
+		div_u64(loops, bench_ms));
+}
+
+static int __init test_zsmalloc_init(void)
+{
+	unsigned int nr_threads = threads ?: num_online_cpus();
+	unsigned int nr, i;
+	struct zs_pool *pool;
+	unsigned long *handles;
+	int ret = 0;
+
+	pool = zs_create_pool("test_zsmalloc");
+	if (!pool)
+		return -ENOMEM;
+
+	/* two objects of each kind per zspage, one per worker of each kind */
+	nr = round_up(nr_threads * 2, TEST_ZS_OBJS_PER_ZSPAGE);
+	handles = kcalloc(nr, sizeof(*handles), GFP_KERNEL);
+	if (!handles) {
+		ret = -ENOMEM;
+		goto destroy;
+	}
+	for (i = 0; i < nr; ++i) {
+		handles[i] = zs_malloc(pool, TEST_ZS_SIZE, GFP_KERNEL);
+		if (!handles[i]) {
+			ret = -ENOMEM;
+			goto free;
+		}
+	}
+
+	for (i = 0; i < nr; ++i)
+		check_object(pool, handles[i], i);
+
+	if (bench_ms && !failed_tests) {
+		pr_info("within a page: %llu maps/ms\n",
+			div_u64(bench_map(pool, handles[0]), bench_ms));
+		pr_info("spanning two pages: %llu maps/ms\n",
+			div_u64(bench_map(pool, handles[1]), bench_ms));
+		bench_parallel(pool, handles, nr_threads, false);
+		bench_parallel(pool, handles, nr_threads, true);
+	}
+
+free:
+	for (i = 0; i < nr && handles[i]; ++i)
+		zs_free(pool, handles[i]);
+	kfree(handles);
+destroy:
+	zs_destroy_pool(pool);
+	if (ret)
+		return ret;
+
+	if (failed_tests) {
+		pr_err("failed %u out of %u tests\n", failed_tests,
+		       total_tests);
+		return -EINVAL;
+	}
+	pr_info("all %u tests passed\n", total_tests);
+	return 0;
+}
+
+static void __exit test_zsmalloc_exit(void)
+{
+}
+
+module_init(test_zsmalloc_init);
+module_exit(test_zsmalloc_exit);
+
+MODULE_LICENSE("GPL");
@@ -92,6 +92,11 @@ struct damos *damon_new_scheme(
 	scheme->max_age_region = max_age_region;
 	scheme->action = action;
 	scheme->stat = (struct damos_stat){};
+	scheme->memcg = NULL;
+	scheme->skip_memcgs = NULL;
+	scheme->nr_skip_memcgs = 0;
+	scheme->anon_only = false;
+	scheme->sz_filter_passed = 0;
 	INIT_LIST_HEAD(&scheme->list);
 
 	scheme->quota.ms = quota->ms;
@@ -555,6 +560,11 @@ static bool damos_valid_target(struct damon_ctx *c, struct damon_target *t,
 	return c->primitive.get_scheme_score(c, t, r, s) >= s->quota.min_score;
 }
 
+static bool damos_has_filter(struct damos *s)
+{
+	return s->memcg || s->nr_skip_memcgs || s->anon_only;
+}
+
 static void damon_do_apply_schemes(struct damon_ctx *c,
 				   struct damon_target *t,
 				   struct damon_region *r)
@@ -623,7 +633,11 @@ static void damon_do_apply_schemes(struct damon_ctx *c,
 			ktime_get_coarse_ts64(&end);
 			quota->total_charged_ns += timespec64_to_ns(&end) -
 				timespec64_to_ns(&begin);
-			quota->charged_sz += sz;
+			/* charge only the pages the action could apply to */
+			if (damos_has_filter(s))
+				quota->charged_sz += s->sz_filter_passed;
+			else
+				quota->charged_sz += sz;
 			if (quota->esz && quota->charged_sz >= quota->esz) {
 				quota->charge_target_from = t;
 				quota->charge_addr_from = r->ar.end + 1;
@@ -213,13 +213,37 @@ bool damon_pa_target_valid(void *t)
 	return true;
 }
 
+/* Whether @page passes the memcg and anon filters of @scheme */
+static bool damon_pa_filter_page(struct page *page, struct damos *scheme)
+{
+#ifdef CONFIG_MEMCG
+	struct mem_cgroup *memcg = READ_ONCE(page->mem_cgroup);
+	unsigned int i;
+#endif
+
+	if (scheme->anon_only && !PageAnon(page))
+		return false;
+
+#ifdef CONFIG_MEMCG
+	if (scheme->memcg && memcg != scheme->memcg)
+		return false;
+	for (i = 0; i < scheme->nr_skip_memcgs; i++) {
+		if (memcg == scheme->skip_memcgs[i])
+			return false;
+	}
+#endif
+
+	return true;
+}
+
 static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
 {
-	unsigned long addr, applied;
+	unsigned long addr, applied, passed = 0;
 	LIST_HEAD(page_list);
 
+	scheme->sz_filter_passed = 0;
 	if (scheme->action != DAMOS_PAGEOUT)
 		return 0;
 
@@ -229,6 +253,12 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		if (!page)
 			continue;
 
+		if (!damon_pa_filter_page(page, scheme)) {
+			put_page(page);
+			continue;
+		}
+		passed++;
+
 		ClearPageReferenced(page);
 		test_and_clear_page_young(page);
 		if (isolate_lru_page(page)) {
@@ -244,6 +274,7 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 	}
 	applied = reclaim_pages(&page_list);
 	cond_resched();
+	scheme->sz_filter_passed = passed * PAGE_SIZE;
 	return applied * PAGE_SIZE;
 }
 
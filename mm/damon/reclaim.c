@@ -9,8 +9,11 @@
 
 #include <linux/damon.h>
 #include <linux/ioport.h>
+#include <linux/memcontrol.h>
 #include <linux/module.h>
+#include <linux/mutex.h>
 #include <linux/sched.h>
+#include <linux/slab.h>
 #include <linux/workqueue.h>
 
 #ifdef MODULE_PARAM_PREFIX
@@ -250,7 +253,8 @@ static bool get_monitoring_region(unsigned long *start, unsigned long *end)
 	return true;
 }
 
-static struct damos *damon_reclaim_new_scheme(void)
+static struct damos *damon_reclaim_new_scheme(unsigned long min_age,
+		unsigned long quota_ms, unsigned long quota_sz)
 {
 	struct damos_watermarks wmarks = {
 		.metric = DAMOS_WMARK_FREE_MEM_RATE,
@@ -289,6 +293,384 @@ static struct damos *damon_reclaim_new_scheme(void)
 	return scheme;
 }
 
+#ifdef CONFIG_MEMCG
+/*
+ * Maximum number of cgroups that can have their own reclaim scheme.
+ */
+#define DAMON_RECLAIM_MAX_MEMCGS	64
+
+/*
+ * A cgroup with its own reclamation scheme.  The scheme runs in the same
+ * context as the global one, so all of them share one monitoring thread, and
+ * only pages out anonymous pages charged to the cgroup.  On systems swapping
+ * to zram, that moves the cold memory of the app into zram.
+ *
+ * The cgroup is identified by its path, which is resolved again whenever the
+ * schemes are built.  The memcg found then stays pinned while the schemes run,
+ * so they can't end up matching pages of another cgroup.  Once the cgroup is
+ * removed, the schemes are built again and the entry is dropped, unless a new
+ * cgroup has been created at the same path.  The running context gets the new
+ * schemes from its after_aggregation callback, so the monitoring results
+ * survive the change.
+ */
+struct damon_reclaim_memcg {
+	char *path;
+	struct mem_cgroup *memcg;
+	/* removed by the user, freed once the schemes don't use @memcg */
+	bool removed;
+	unsigned long min_age;
+	unsigned long quota_ms;
+	unsigned long quota_sz;
+	/* stats of the schemes of previous runs, and of all runs */
+	struct damos_stat base_stat;
+	struct damos_stat stat;
+	struct list_head list;
+};
+
+static LIST_HEAD(damon_reclaim_memcgs);
+static int nr_damon_reclaim_memcgs;
+static bool damon_reclaim_memcgs_changed;
+/* whether schemes of the running context point at the pinned memcgs */
+static bool damon_reclaim_memcgs_in_use;
+/* the memcgs with their own scheme, which the global scheme leaves alone */
+static struct mem_cgroup *damon_reclaim_skip_memcgs[DAMON_RECLAIM_MAX_MEMCGS];
+static DEFINE_MUTEX(damon_reclaim_memcgs_lock);
+
+static struct damon_reclaim_memcg *damon_reclaim_find_memcg(const char *path)
+{
+	struct damon_reclaim_memcg *m;
+
+	list_for_each_entry(m, &damon_reclaim_memcgs, list) {
+		if (!m->removed && !strcmp(m->path, path))
+			return m;
+	}
+	return NULL;
+}
+
+/*
+ * Returns the online memcg at cgroup @path with a reference held, or NULL if
+ * there is none.
+ */
+static struct mem_cgroup *damon_reclaim_get_memcg(const char *path)
+{
+	struct mem_cgroup *memcg, *found = NULL;
+	char *buf;
+
+	buf = kmalloc(PATH_MAX, GFP_KERNEL);
+	if (!buf)
+		return NULL;
+
+	for (memcg = mem_cgroup_iter(NULL, NULL, NULL); memcg;
+			memcg = mem_cgroup_iter(NULL, memcg, NULL)) {
+		if (!mem_cgroup_online(memcg))
+			continue;
+		cgroup_path(memcg->css.cgroup, buf, PATH_MAX);
+		if (!strcmp(buf, path)) {
+			css_get(&memcg->css);
+			found = memcg;
+			mem_cgroup_iter_break(NULL, memcg);
+			break;
+		}
+	}
+
+	kfree(buf);
+	return found;
+}
+
+static void damon_reclaim_free_memcg(struct damon_reclaim_memcg *m)
+{
+	list_del(&m->list);
+	if (!m->removed)
+		nr_damon_reclaim_memcgs--;
+	if (m->memcg)
+		css_put(&m->memcg->css);
+	kfree(m->path);
+	kfree(m);
+}
+
+/*
+ * Adds the per-cgroup schemes, and excludes their cgroups from @global.  Must
+ * be called while kdamond is not running or from kdamond itself, after the
+ * previous per-cgroup schemes are gone, as the memcgs pinned for them are
+ * released here.
+ */
+static int damon_reclaim_add_memcg_schemes(struct damos *global)
+{
+	struct damon_reclaim_memcg *m, *next;
+	struct damos *scheme;
+	unsigned int nr_skip = 0;
+	int err = 0;
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	list_for_each_entry_safe(m, next, &damon_reclaim_memcgs, list) {
+		if (m->memcg) {
+			css_put(&m->memcg->css);
+			m->memcg = NULL;
+		}
+		if (!m->removed)
+			m->memcg = damon_reclaim_get_memcg(m->path);
+		/* removed by the user, or the cgroup has gone */
+		if (!m->memcg) {
+			damon_reclaim_free_memcg(m);
+			continue;
+		}
+		damon_reclaim_skip_memcgs[nr_skip++] = m->memcg;
+
+		if (err)
+			continue;
+		scheme = damon_reclaim_new_scheme(m->min_age, m->quota_ms,
+				m->quota_sz);
+		if (!scheme) {
+			err = -ENOMEM;
+			continue;
+		}
+		scheme->memcg = m->memcg;
+		scheme->anon_only = true;
+		damon_add_scheme(ctx, scheme);
+		m->base_stat = m->stat;
+	}
+	global->skip_memcgs = damon_reclaim_skip_memcgs;
+	global->nr_skip_memcgs = nr_skip;
+	/* a running context tries again after the next aggregation */
+	damon_reclaim_memcgs_changed = err != 0;
+	damon_reclaim_memcgs_in_use = true;
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+
+	return err;
+}
+
+/* Called after kdamond has stopped, not to keep removed cgroups around */
+static void damon_reclaim_release_memcgs(void)
+{
+	struct damon_reclaim_memcg *m, *next;
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	list_for_each_entry_safe(m, next, &damon_reclaim_memcgs, list) {
+		if (m->removed) {
+			damon_reclaim_free_memcg(m);
+			continue;
+		}
+		if (m->memcg) {
+			css_put(&m->memcg->css);
+			m->memcg = NULL;
+		}
+	}
+	damon_reclaim_memcgs_in_use = false;
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+}
+
+static void damon_reclaim_update_memcg_stat(struct damos *s)
+{
+	struct damon_reclaim_memcg *m;
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	list_for_each_entry(m, &damon_reclaim_memcgs, list) {
+		if (m->memcg != s->memcg)
+			continue;
+		m->stat.nr_tried = m->base_stat.nr_tried + s->stat.nr_tried;
+		m->stat.sz_tried = m->base_stat.sz_tried + s->stat.sz_tried;
+		m->stat.nr_applied = m->base_stat.nr_applied +
+			s->stat.nr_applied;
+		m->stat.sz_applied = m->base_stat.sz_applied +
+			s->stat.sz_applied;
+		m->stat.qt_exceeds = m->base_stat.qt_exceeds +
+			s->stat.qt_exceeds;
+		break;
+	}
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+}
+
+/* Whether the schemes need to be built again, also if a cgroup has gone */
+static bool damon_reclaim_test_and_clear_memcgs_changed(void)
+{
+	struct damon_reclaim_memcg *m;
+	bool changed;
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	changed = damon_reclaim_memcgs_changed;
+	list_for_each_entry(m, &damon_reclaim_memcgs, list) {
+		if (m->memcg && !mem_cgroup_online(m->memcg))
+			changed = true;
+	}
+	damon_reclaim_memcgs_changed = false;
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+
+	return changed;
+}
+
+/*
+ * Builds the per-cgroup schemes of the running context @c again if they have
+ * changed.  Called by kdamond, so the regions and their ages are kept, as is
+ * the global scheme with its stats and quota.
+ */
+static void damon_reclaim_rebuild_memcg_schemes(struct damon_ctx *c)
+{
+	struct damos *s, *next, *global = NULL;
+	int err;
+
+	if (!damon_reclaim_test_and_clear_memcgs_changed())
+		return;
+
+	damon_for_each_scheme_safe(s, next, c) {
+		if (s->memcg)
+			damon_destroy_scheme(s);
+		else
+			global = s;
+	}
+	if (!global)
+		return;
+
+	err = damon_reclaim_add_memcg_schemes(global);
+	if (err)
+		pr_warn_ratelimited("failed to rebuild cgroup schemes: %d\n",
+				err);
+}
+
+static int memcgs_store(const char *val, const struct kernel_param *kp)
+{
+	struct damon_reclaim_memcg *m;
+	struct mem_cgroup *memcg;
+	unsigned long min_age, quota_ms, quota_sz;
+	char *buf, *args, *path;
+	int err = 0;
+
+	buf = kstrdup(val, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+
+	args = strim(buf);
+	path = strsep(&args, " ");
+	if (!args) {
+		err = -EINVAL;
+		goto out;
+	}
+	args = skip_spaces(args);
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	m = damon_reclaim_find_memcg(path);
+	if (!strcmp(args, "off")) {
+		if (!m) {
+			err = -ENOENT;
+			goto unlock;
+		}
+		/* a running scheme may still use the memcg */
+		if (damon_reclaim_memcgs_in_use) {
+			m->removed = true;
+			nr_damon_reclaim_memcgs--;
+		} else {
+			damon_reclaim_free_memcg(m);
+		}
+		damon_reclaim_memcgs_changed = true;
+		goto unlock;
+	}
+
+	if (sscanf(args, "%lu %lu %lu", &min_age, &quota_ms, &quota_sz) != 3) {
+		err = -EINVAL;
+		goto unlock;
+	}
+
+	if (!m) {
+		/* fail early for a cgroup which doesn't exist */
+		memcg = damon_reclaim_get_memcg(path);
+		if (!memcg) {
+			err = -ENOENT;
+			goto unlock;
+		}
+		css_put(&memcg->css);
+
+		if (nr_damon_reclaim_memcgs >= DAMON_RECLAIM_MAX_MEMCGS) {
+			err = -ENOSPC;
+			goto unlock;
+		}
+		m = kzalloc(sizeof(*m), GFP_KERNEL);
+		if (!m) {
+			err = -ENOMEM;
+			goto unlock;
+		}
+		m->path = kstrdup(path, GFP_KERNEL);
+		if (!m->path) {
+			kfree(m);
+			err = -ENOMEM;
+			goto unlock;
+		}
+		list_add_tail(&m->list, &damon_reclaim_memcgs);
+		nr_damon_reclaim_memcgs++;
+	}
+	m->min_age = min_age;
+	m->quota_ms = quota_ms;
+	m->quota_sz = quota_sz;
+	damon_reclaim_memcgs_changed = true;
+unlock:
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+out:
+	kfree(buf);
+	return err;
+}
+
+static int memcgs_show(char *buf, const struct kernel_param *kp)
+{
+	struct damon_reclaim_memcg *m;
+	int len = 0;
+
+	mutex_lock(&damon_reclaim_memcgs_lock);
+	list_for_each_entry(m, &damon_reclaim_memcgs, list) {
+		if (m->removed)
+			continue;
+		len += scnprintf(buf + len, PAGE_SIZE - len,
+				"%s %lu %lu %lu %lu %lu %lu %lu %lu\n",
+				m->path, m->min_age, m->quota_ms, m->quota_sz,
+				m->stat.nr_tried, m->stat.sz_tried,
+				m->stat.nr_applied, m->stat.sz_applied,
+				m->stat.qt_exceeds);
+	}
+	mutex_unlock(&damon_reclaim_memcgs_lock);
+
+	return len;
+}
+
+static const struct kernel_param_ops memcgs_param_ops = {
+	.set = memcgs_store,
+	.get = memcgs_show,
+};
+
+/*
+ * Per-cgroup reclamation schemes.
+ *
+ * Writing "<cgroup path> <min_age> <quota_ms> <quota_sz>" gives the cgroup its
+ * own scheme, with the parameters meaning the same as their global
+ * counterparts, or updates the existing one.  The global scheme then leaves
+ * the memory of the cgroup to its own scheme, so the scheme can be gentler as
+ * well as stricter.  The size quota is charged with the anonymous pages of the
+ * cgroup that the scheme found in the cold regions, rather than with the size
+ * of those regions.  The global scheme likewise charges only the pages not
+ * left to a per-cgroup scheme.  Writing "<cgroup path> off"
+ * removes it.  The schemes work only while DAMON_RECLAIM is enabled, and
+ * changes take effect after the next aggregation, without losing the
+ * monitoring results.  The entry of a cgroup which is removed is dropped.
+ *
+ * Reading shows a line per cgroup: the path, the three parameters and the
+ * stats of its scheme, in the order of the global stats parameters.
+ */
+module_param_cb(memcgs, &memcgs_param_ops, NULL, 0600);
+#else
+static int damon_reclaim_add_memcg_schemes(struct damos *global)
+{
+	return 0;
+}
+
+static void damon_reclaim_release_memcgs(void)
+{
+}
+
+static void damon_reclaim_update_memcg_stat(struct damos *s)
+{
+}
+
+static void damon_reclaim_rebuild_memcg_schemes(struct damon_ctx *c)
+{
+}
+#endif /* CONFIG_MEMCG */
+
 static int damon_reclaim_turn(bool on)
 {
 	struct damon_region *region;
@@ -297,8 +679,10 @@ static int damon_reclaim_turn(bool on)
 
 	if (!on) {
 		err = damon_stop(&ctx, 1);
-		if (!err)
+		if (!err) {
 			kdamond_pid = -1;
+			damon_reclaim_release_memcgs();
+		}
 		return err;
 	}
 
@@ -320,12 +704,16 @@ static int damon_reclaim_turn(bool on)
 	damon_add_region(region, target);
 
 	/* Will be freed by 'damon_set_schemes()' below */
-	scheme = damon_reclaim_new_scheme();
+	scheme = damon_reclaim_new_scheme(min_age, quota_ms, quota_sz);
 	if (!scheme) {
 		err = -ENOMEM;
 		goto free_region_out;
 	}
 	err = damon_set_schemes(ctx, &scheme, 1);
+	if (err)
+		goto free_scheme_out;
+	/* Freed by the next 'damon_set_schemes()' on failure */
+	err = damon_reclaim_add_memcg_schemes(scheme);
 	if (err)
 		goto free_scheme_out;
 
@@ -348,13 +736,18 @@ static void damon_reclaim_timer_fn(struct work_struct *work)
 {
 	static bool last_enabled;
 	bool now_enabled;
+	int err;
 
 	now_enabled = enabled;
 	if (last_enabled != now_enabled) {
-		if (!damon_reclaim_turn(now_enabled))
+		err = damon_reclaim_turn(now_enabled);
+		if (!err) {
 			last_enabled = now_enabled;
-		else
+		} else {
+			pr_err("failed to turn %s: %d\n",
+					now_enabled ? "on" : "off", err);
 			enabled = last_enabled;
+		}
 	}
 
 	if (enabled)
@@ -392,12 +785,18 @@ static int damon_reclaim_after_aggregation(struct damon_ctx *c)
 
 	/* update the stats parameter */
 	damon_for_each_scheme(s, c) {
+		if (s->memcg) {
+			damon_reclaim_update_memcg_stat(s);
+			continue;
+		}
 		nr_reclaim_tried_regions = s->stat.nr_tried;
 		bytes_reclaim_tried_regions = s->stat.sz_tried;
 		nr_reclaimed_regions = s->stat.nr_applied;
 		bytes_reclaimed_regions = s->stat.sz_applied;
 		nr_quota_exceeds = s->stat.qt_exceeds;
 	}
+
+	damon_reclaim_rebuild_memcg_schemes(c);
 	return 0;
 }
 
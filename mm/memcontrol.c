@@ -1642,6 +1642,15 @@ static char *memory_stat_format(struct mem_cgroup *memcg)
 	seq_buf_printf(&s, "%s %lu\n", vm_event_name(PGLAZYFREED),
 		       memcg_events(memcg, PGLAZYFREED));
 
+#ifdef CONFIG_SWAP
+	seq_buf_printf(&s, "%s %lu\n", vm_event_name(SWAP_RA),
+		       memcg_events(memcg, SWAP_RA));
+	seq_buf_printf(&s, "%s %lu\n", vm_event_name(SWAP_RA_HIT),
+		       memcg_events(memcg, SWAP_RA_HIT));
+	seq_buf_printf(&s, "%s %lu\n", vm_event_name(SWAP_RA_MISS),
+		       memcg_events(memcg, SWAP_RA_MISS));
+#endif /* CONFIG_SWAP */
+
 #ifdef CONFIG_TRANSPARENT_HUGEPAGE
 	seq_buf_printf(&s, "%s %lu\n", vm_event_name(THP_FAULT_ALLOC),
 		       memcg_events(memcg, THP_FAULT_ALLOC));
@@ -4080,6 +4089,42 @@ static int memcg_numa_stat_show(struct seq_file *m, void *v)
 }
 #endif /* CONFIG_NUMA */
 
+#ifdef CONFIG_LRU_GEN
+static int memcg_lru_gen_show(struct seq_file *m, void *v)
+{
+	lru_gen_memcg_show(m, mem_cgroup_from_seq(m));
+	return 0;
+}
+
+/* "<min_age_ms> <bytes>": reclaim up to <bytes> from generations this old */
+static ssize_t memcg_lru_gen_write(struct kernfs_open_file *of,
+				   char *buf, size_t nbytes, loff_t off)
+{
+	struct mem_cgroup *memcg = mem_cgroup_from_css(of_css(of));
+	unsigned long min_age_ms, nr_bytes;
+	char *age, *end;
+	int ret;
+
+	buf = strstrip(buf);
+	age = strsep(&buf, " ");
+	if (!buf)
+		return -EINVAL;
+
+	ret = kstrtoul(age, 10, &min_age_ms);
+	if (ret)
+		return ret;
+
+	nr_bytes = memparse(skip_spaces(buf), &end);
+	if (*end != '\0' || !nr_bytes)
+		return -EINVAL;
+
+	ret = lru_gen_memcg_reclaim(memcg, msecs_to_jiffies(min_age_ms),
+				    DIV_ROUND_UP(nr_bytes, PAGE_SIZE));
+
+	return ret ? : nbytes;
+}
+#endif /* CONFIG_LRU_GEN */
+
 static const unsigned int memcg1_stats[] = {
 	NR_FILE_PAGES,
 	NR_ANON_MAPPED,
@@ -5112,6 +5157,13 @@ static struct cftype mem_cgroup_legacy_files[] = {
 		.name = "numa_stat",
 		.seq_show = memcg_numa_stat_show,
 	},
+#endif
+#ifdef CONFIG_LRU_GEN
+	{
+		.name = "lru_gen",
+		.seq_show = memcg_lru_gen_show,
+		.write = memcg_lru_gen_write,
+	},
 #endif
 	{
 		.name = "kmem.limit_in_bytes",
@@ -6635,6 +6687,14 @@ static struct cftype memory_files[] = {
 		.name = "numa_stat",
 		.seq_show = memory_numa_stat_show,
 	},
+#endif
+#ifdef CONFIG_LRU_GEN
+	{
+		.name = "lru_gen",
+		.flags = CFTYPE_NOT_ON_ROOT,
+		.seq_show = memcg_lru_gen_show,
+		.write = memcg_lru_gen_write,
+	},
 #endif
 	{
 		.name = "oom.group",
@@ -25,6 +25,14 @@
  * The swap slots cache is protected by a mutex instead of
  * a spin lock as when we search for slots with scan_swap_map,
  * we can possibly sleep.
+ *
+ * When all swap devices do synchronous I/O, like zram, there
+ * is no seek locality to preserve, so the caches are refilled
+ * and flushed in much larger batches to take the swap_info
+ * lock less often.  The caches are only sized for those batches
+ * if swap is all synchronous when they are first allocated.  An
+ * empty cache is then refilled with the slots its CPU returned,
+ * without taking the swap_info lock at all.
  */
 
 #include <linux/swap_slots.h>
@@ -39,6 +47,8 @@ static DEFINE_PER_CPU(struct swap_slots_cache, swp_slots);
 static bool	swap_slot_cache_active;
 bool	swap_slot_cache_enabled;
 static bool	swap_slot_cache_initialized;
+/* entries in each slots and slots_ret array, set once by the first enable */
+static int	swap_slots_cache_size = SWAP_SLOTS_CACHE_SIZE;
 static DEFINE_MUTEX(swap_slots_cache_mutex);
 /* Serialize swap slots cache enable/disable operations */
 static DEFINE_MUTEX(swap_slots_cache_enable_mutex);
@@ -51,6 +61,12 @@ static void reactivate_swap_slots_cache(void);
 #define SLOTS_CACHE 0x1
 #define SLOTS_CACHE_RET 0x2
 
+static inline int swap_slots_batch(void)
+{
+	return atomic_read(&nr_async_swap) ? SWAP_SLOTS_CACHE_SIZE :
+					     swap_slots_cache_size;
+}
+
 static void deactivate_swap_slots_cache(void)
 {
 	mutex_lock(&swap_slots_cache_mutex);
@@ -101,6 +117,7 @@ EXPORT_SYMBOL_GPL(is_swap_slot_cache_enabled);
 bool check_cache_active(void)
 {
 	long pages;
+	int batch = swap_slots_batch();
 
 	if (!swap_slot_cache_enabled)
 		return false;
@@ -108,13 +125,13 @@ bool check_cache_active(void)
 	pages = get_nr_swap_pages();
 	if (!swap_slot_cache_active) {
 		if (pages > num_online_cpus() *
-		    THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE)
+		    THRESHOLD_ACTIVATE_SWAP_SLOTS_CACHE(batch))
 			reactivate_swap_slots_cache();
 		goto out;
 	}
 
 	/* if global pool of slot caches too low, deactivate cache */
-	if (pages < num_online_cpus() * THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE)
+	if (pages < num_online_cpus() * THRESHOLD_DEACTIVATE_SWAP_SLOTS_CACHE(batch))
 		deactivate_swap_slots_cache();
 out:
 	return swap_slot_cache_active;
@@ -139,12 +156,12 @@ static int alloc_swap_slot_cache(unsigned int cpu)
 		&ret, &skip);
 	if (skip)
 		return ret;
-	slots = kvcalloc(SWAP_SLOTS_CACHE_SIZE, sizeof(swp_entry_t),
+	slots = kvcalloc(swap_slots_cache_size, sizeof(swp_entry_t),
 			 GFP_KERNEL);
 	if (!slots)
 		return -ENOMEM;
 
-	slots_ret = kvcalloc(SWAP_SLOTS_CACHE_SIZE, sizeof(swp_entry_t),
+	slots_ret = kvcalloc(swap_slots_cache_size, sizeof(swp_entry_t),
 			     GFP_KERNEL);
 	if (!slots_ret) {
 		kvfree(slots);
@@ -268,6 +285,9 @@ void enable_swap_slots_cache(void)
 	if (!swap_slot_cache_initialized) {
 		int ret;
 
+		/* called by swapon once the device is counted */
+		if (!atomic_read(&nr_async_swap))
+			swap_slots_cache_size = SWAP_SLOTS_CACHE_SIZE_SYNC_IO;
 		ret = cpuhp_setup_state(CPUHP_AP_ONLINE_DYN, "swap_slots_cache",
 					alloc_swap_slot_cache, free_slot_cache);
 		if (WARN_ONCE(ret < 0, "Cache allocation failed (%s), operating "
@@ -282,6 +302,34 @@ void enable_swap_slots_cache(void)
 	mutex_unlock(&swap_slots_cache_enable_mutex);
 }
 
+/*
+ * Refill the cache with the slots returned on its CPU, by swapping the two
+ * arrays, when all swap devices do synchronous I/O.  Called with swap slot
+ * cache's alloc lock held.
+ */
+static int recycle_swap_slots_cache(struct swap_slots_cache *cache)
+{
+	swp_entry_t *slots;
+
+	if (atomic_read(&nr_async_swap) || !cache->slots_ret)
+		return 0;
+
+	spin_lock_irq(&cache->free_lock);
+	if (!cache->slots_ret || !cache->n_ret) {
+		spin_unlock_irq(&cache->free_lock);
+		return 0;
+	}
+	slots = cache->slots_ret;
+	cache->slots_ret = cache->slots;
+	cache->slots = slots;
+	cache->nr = cache->n_ret;
+	cache->n_ret = 0;
+	spin_unlock_irq(&cache->free_lock);
+
+	swapcache_recycle_entries(cache->slots, cache->nr);
+	return cache->nr;
+}
+
 /* called with swap slot cache's alloc lock held */
 static int refill_swap_slots_cache(struct swap_slots_cache *cache)
 {
@@ -289,8 +337,8 @@ static int refill_swap_slots_cache(struct swap_slots_cache *cache)
 		return 0;
 
 	cache->cur = 0;
-	if (swap_slot_cache_active)
-		cache->nr = get_swap_pages(SWAP_SLOTS_CACHE_SIZE,
+	if (swap_slot_cache_active && !recycle_swap_slots_cache(cache))
+		cache->nr = get_swap_pages(swap_slots_batch(),
 					   cache->slots, 1);
 
 	return cache->nr;
@@ -313,7 +361,7 @@ int free_swap_slot(swp_entry_t entry)
 			spin_unlock_irq(&cache->free_lock);
 			goto direct_free;
 		}
-		if (cache->n_ret >= SWAP_SLOTS_CACHE_SIZE) {
+		if (cache->n_ret >= swap_slots_batch()) {
 			/*
 			 * Return slots to global pool.
 			 * The current swap_map value is SWAP_HAS_CACHE.
@@ -387,3 +435,4 @@ swp_entry_t get_swap_page(struct page *page)
 	}
 	return entry;
 }
+EXPORT_SYMBOL_GPL(get_swap_page);
@@ -200,6 +200,11 @@ void __delete_from_swap_cache(struct page *page,
 		xas_next(&xas);
 	}
 	ClearPageSwapCache(page);
+	/* a readahead page leaving the cache untouched was wasted I/O */
+	if (PageReadahead(page)) {
+		count_vm_event(SWAP_RA_MISS);
+		count_memcg_page_event(page, SWAP_RA_MISS);
+	}
 	if (shadow)
 		address_space->nrexceptional += nr;
 	address_space->nrpages -= nr;
@@ -408,6 +413,7 @@ struct page *lookup_swap_cache(swp_entry_t entry, struct vm_area_struct *vma,
 
 		if (readahead) {
 			count_vm_event(SWAP_RA_HIT);
+			count_memcg_page_event(page, SWAP_RA_HIT);
 			if (!vma || !vma_ra)
 				atomic_inc(&swapin_readahead_hits);
 		}
@@ -571,10 +577,21 @@ static unsigned int __swapin_nr_pages(unsigned long prev_offset,
 				      unsigned long offset,
 				      int hits,
 				      int max_pages,
-				      int prev_win)
+				      int prev_win,
+				      bool sync_io)
 {
 	unsigned int pages, last_ra;
 
+	/*
+	 * Readahead from a synchronous device such as zram hides no I/O
+	 * latency, it only burns CPU decompressing pages up front. Once less
+	 * than half of the previous window got used, drop to a single page
+	 * right away rather than guessing from the fault pattern or shrinking
+	 * gradually.
+	 */
+	if (sync_io && prev_win > 1 && hits * 2 < prev_win - 1)
+		return 1;
+
 	/*
 	 * This heuristic has been found to work well on both sequential and
 	 * random loads, swapping to hard disk or to SSD: please don't ask
@@ -607,7 +624,8 @@ static unsigned int __swapin_nr_pages(unsigned long prev_offset,
 	return pages;
 }
 
-static unsigned long swapin_nr_pages(unsigned long offset)
+static unsigned long swapin_nr_pages(struct swap_info_struct *si,
+				     unsigned long offset)
 {
 	static unsigned long prev_offset;
 	unsigned int hits, pages, max_pages;
@@ -620,7 +638,8 @@ static unsigned long swapin_nr_pages(unsigned long offset)
 	hits = atomic_xchg(&swapin_readahead_hits, 0);
 	pages = __swapin_nr_pages(READ_ONCE(prev_offset), offset, hits,
 				  max_pages,
-				  atomic_read(&last_readahead_pages));
+				  atomic_read(&last_readahead_pages),
+				  si->flags & SWP_SYNCHRONOUS_IO);
 	if (!hits)
 		WRITE_ONCE(prev_offset, offset);
 	atomic_set(&last_readahead_pages, pages);
@@ -664,7 +683,7 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 	struct vm_area_struct *vma = vmf->vma;
 	unsigned long addr = vmf->address;
 
-	mask = swapin_nr_pages(offset) - 1;
+	mask = swapin_nr_pages(si, offset) - 1;
 	if (!mask)
 		goto skip;
 
@@ -697,6 +716,7 @@ struct page *swap_cluster_readahead(swp_entry_t entry, gfp_t gfp_mask,
 			if (offset != entry_offset) {
 				SetPageReadahead(page);
 				count_vm_event(SWAP_RA);
+				count_memcg_page_event(page, SWAP_RA);
 			}
 		}
 		put_page(page);
@@ -785,8 +805,8 @@ static void swap_ra_info(struct vm_fault *vmf,
 	pfn = PFN_DOWN(SWAP_RA_ADDR(ra_val));
 	prev_win = SWAP_RA_WIN(ra_val);
 	hits = SWAP_RA_HITS(ra_val);
-	ra_info->win = win = __swapin_nr_pages(pfn, fpfn, hits,
-					       max_win, prev_win);
+	ra_info->win = win = __swapin_nr_pages(pfn, fpfn, hits, max_win, prev_win,
+					       swp_swap_info(entry)->flags & SWP_SYNCHRONOUS_IO);
 	atomic_long_set(&vma->swap_readahead_info,
 			SWAP_RA_VAL(faddr, win, 0));
 
@@ -869,6 +889,7 @@ static struct page *swap_vma_readahead(swp_entry_t fentry, gfp_t gfp_mask,
 			if (i != ra_info.offset) {
 				SetPageReadahead(page);
 				count_vm_event(SWAP_RA);
+				count_memcg_page_event(page, SWAP_RA);
 			}
 		}
 		put_page(page);
@@ -98,6 +98,8 @@ static DECLARE_WAIT_QUEUE_HEAD(proc_poll_wait);
 static atomic_t proc_poll_event = ATOMIC_INIT(0);
 
 atomic_t nr_rotate_swap = ATOMIC_INIT(0);
+/* number of swap devices not doing synchronous I/O */
+atomic_t nr_async_swap = ATOMIC_INIT(0);
 
 struct swap_info_struct *swap_type_to_swap_info(int type)
 {
@@ -1085,7 +1087,10 @@ int get_swap_pages(int n_goal, swp_entry_t swp_entries[], int entry_size)
 		goto noswap;
 	}
 
-	n_goal = min3((long)n_goal, (long)SWAP_BATCH, avail_pgs);
+	n_goal = min3((long)n_goal,
+		      atomic_read(&nr_async_swap) ? (long)SWAP_BATCH :
+						    (long)SWAP_BATCH_SYNC_IO,
+		      avail_pgs);
 
 	atomic_long_sub(n_goal * size, &nr_swap_pages);
 
@@ -1449,6 +1454,7 @@ void put_swap_page(struct page *page, swp_entry_t entry)
 	}
 	unlock_cluster_or_swap_info(si, ci);
 }
+EXPORT_SYMBOL_GPL(put_swap_page);
 
 #ifdef CONFIG_THP_SWAP
 int split_swap_cluster(swp_entry_t entry)
@@ -1503,6 +1509,37 @@ void swapcache_free_entries(swp_entry_t *entries, int n)
 }
 EXPORT_SYMBOL_GPL(swapcache_free_entries);
 
+/*
+ * Makes entries returned to a swap slots cache ready to be handed out again
+ * without going back to the device, so swap_info lock is not taken.  They
+ * keep SWAP_HAS_CACHE and so stay allocated, but everything else that
+ * swap_entry_free() does for a slot is done here.
+ */
+void swapcache_recycle_entries(swp_entry_t *entries, int n)
+{
+	void (*swap_slot_free_notify)(struct block_device *, unsigned long);
+	struct swap_info_struct *si;
+	unsigned long offset;
+	int i;
+
+	for (i = 0; i < n; ++i) {
+		si = swp_swap_info(entries[i]);
+		offset = swp_offset(entries[i]);
+		VM_BUG_ON(READ_ONCE(si->swap_map[offset]) != SWAP_HAS_CACHE);
+
+		mem_cgroup_uncharge_swap(entries[i], 1);
+		arch_swap_invalidate_page(si->type, offset);
+		frontswap_invalidate_page(si->type, offset);
+		if (si->flags & SWP_BLKDEV) {
+			swap_slot_free_notify =
+				si->bdev->bd_disk->fops->swap_slot_free_notify;
+			if (swap_slot_free_notify)
+				swap_slot_free_notify(si->bdev, offset);
+		}
+		clear_shadow_from_swap_cache(si->type, offset, offset);
+	}
+}
+
 /*
  * How many references to page are currently swapped out?
  * This does not give an exact answer when swap count is continued,
@@ -2702,6 +2739,8 @@ SYSCALL_DEFINE1(swapoff, const char __user *, specialfile)
 
 	if (!p->bdev || !blk_queue_nonrot(bdev_get_queue(p->bdev)))
 		atomic_dec(&nr_rotate_swap);
+	if (!(p->flags & SWP_SYNCHRONOUS_IO))
+		atomic_dec(&nr_async_swap);
 
 	mutex_lock(&swapon_mutex);
 	spin_lock(&swap_lock);
@@ -3218,6 +3257,7 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	struct page *page = NULL;
 	struct inode *inode = NULL;
 	bool inced_nr_rotate_swap = false;
+	bool inced_nr_async_swap = false;
 
 	if (swap_flags & ~SWAP_FLAGS_VALID)
 		return -EINVAL;
@@ -3291,8 +3331,12 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	if (p->bdev && blk_queue_stable_writes(p->bdev->bd_disk->queue))
 		p->flags |= SWP_STABLE_WRITES;
 
-	if (p->bdev && p->bdev->bd_disk->fops->rw_page)
+	if (p->bdev && p->bdev->bd_disk->fops->rw_page) {
 		p->flags |= SWP_SYNCHRONOUS_IO;
+	} else {
+		atomic_inc(&nr_async_swap);
+		inced_nr_async_swap = true;
+	}
 
 	if (p->bdev && blk_queue_nonrot(bdev_get_queue(p->bdev))) {
 		int cpu;
@@ -3450,6 +3494,8 @@ SYSCALL_DEFINE2(swapon, const char __user *, specialfile, int, swap_flags)
 	kvfree(frontswap_map);
 	if (inced_nr_rotate_swap)
 		atomic_dec(&nr_rotate_swap);
+	if (inced_nr_async_swap)
+		atomic_dec(&nr_async_swap);
 	if (swap_file)
 		filp_close(swap_file, NULL);
 out:
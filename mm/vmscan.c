@@ -5342,6 +5342,138 @@ static const struct file_operations lru_gen_ro_fops = {
 	.release = seq_release,
 };
 
+#ifdef CONFIG_MEMCG
+/******************************************************************************
+ *                          memcg interface
+ ******************************************************************************/
+
+/*
+ * Prints one line per generation of each node of @memcg: seq, age in ms,
+ * anon pages and file pages. Unlike debugfs, this only covers @memcg itself
+ * and can be read by whoever owns the cgroup.
+ */
+void lru_gen_memcg_show(struct seq_file *m, struct mem_cgroup *memcg)
+{
+	int nid;
+
+	for_each_node_state(nid, N_MEMORY) {
+		unsigned long seq;
+		struct lruvec *lruvec = get_lruvec(memcg, nid);
+		struct lru_gen_struct *lrugen = &lruvec->lrugen;
+		DEFINE_MAX_SEQ(lruvec);
+		DEFINE_MIN_SEQ(lruvec);
+
+		seq_printf(m, "node %d\n", nid);
+
+		for (seq = min(min_seq[LRU_GEN_ANON], min_seq[LRU_GEN_FILE]);
+		     seq <= max_seq; seq++) {
+			int type, zone;
+			int gen = lru_gen_from_seq(seq);
+			unsigned long birth = READ_ONCE(lrugen->timestamps[gen]);
+
+			seq_printf(m, " %10lu %10u", seq, jiffies_to_msecs(jiffies - birth));
+
+			for (type = 0; type < ANON_AND_FILE; type++) {
+				unsigned long size = 0;
+
+				if (seq >= min_seq[type]) {
+					for (zone = 0; zone < MAX_NR_ZONES; zone++)
+						size += max_t(long,
+							      READ_ONCE(lrugen->nr_pages[gen][type][zone]), 0);
+				}
+
+				seq_printf(m, " %10lu", size);
+			}
+
+			seq_putc(m, '\n');
+		}
+	}
+}
+
+/* the youngest evictable generation that is at least min_age old */
+static bool get_old_seq(struct lruvec *lruvec, int swappiness, unsigned long min_age,
+			unsigned long *seq)
+{
+	unsigned long s;
+	struct lru_gen_struct *lrugen = &lruvec->lrugen;
+	DEFINE_MAX_SEQ(lruvec);
+	DEFINE_MIN_SEQ(lruvec);
+
+	/* the youngest MIN_NR_GENS generations can't be evicted */
+	for (s = max_seq - MIN_NR_GENS + 1; s-- > min_seq[!swappiness];) {
+		unsigned long birth = READ_ONCE(lrugen->timestamps[lru_gen_from_seq(s)]);
+
+		if (time_after_eq(jiffies, birth + min_age)) {
+			*seq = s;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+ * Proactively reclaims up to @nr_to_reclaim pages of @memcg, only from
+ * generations at least @min_age (in jiffies) old, so that a userspace agent
+ * can trim cold memory of a backgrounded app without touching its working
+ * set. Returns -EAGAIN if fewer pages were reclaimed.
+ */
+int lru_gen_memcg_reclaim(struct mem_cgroup *memcg, unsigned long min_age,
+			  unsigned long nr_to_reclaim)
+{
+	int nid;
+	unsigned int flags;
+	struct blk_plug plug;
+	unsigned long nr_reclaimed = 0;
+	int err = 0;
+	struct scan_control sc = {
+		.may_writepage = true,
+		.may_unmap = true,
+		.may_swap = true,
+		.reclaim_idx = MAX_NR_ZONES - 1,
+		.gfp_mask = GFP_KERNEL,
+	};
+
+	if (!lru_gen_enabled())
+		return -EOPNOTSUPP;
+
+	set_task_reclaim_state(current, &sc.reclaim_state);
+	flags = memalloc_noreclaim_save();
+	blk_start_plug(&plug);
+	if (!set_mm_walk(NULL)) {
+		err = -ENOMEM;
+		goto done;
+	}
+
+	for_each_node_state(nid, N_MEMORY) {
+		unsigned long seq;
+		struct lruvec *lruvec = get_lruvec(memcg, nid);
+		int swappiness = get_swappiness(lruvec, &sc);
+
+		if (nr_reclaimed >= nr_to_reclaim)
+			break;
+
+		if (!get_old_seq(lruvec, swappiness, min_age, &seq))
+			continue;
+
+		err = run_eviction(lruvec, seq, &sc, swappiness, nr_to_reclaim - nr_reclaimed);
+		nr_reclaimed += sc.nr_reclaimed;
+		if (err)
+			break;
+	}
+done:
+	clear_mm_walk();
+	blk_finish_plug(&plug);
+	memalloc_noreclaim_restore(flags);
+	set_task_reclaim_state(current, NULL);
+
+	if (!err && nr_reclaimed < nr_to_reclaim)
+		err = -EAGAIN;
+
+	return err;
+}
+#endif /* CONFIG_MEMCG */
+
 /******************************************************************************
  *                          initialization
  ******************************************************************************/
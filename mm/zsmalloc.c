@@ -57,6 +57,8 @@
 #include <linux/wait.h>
 #include <linux/pagemap.h>
 #include <linux/fs.h>
+#include <linux/moduleparam.h>
+#include <linux/sched/clock.h>
 
 #define ZSPAGE_MAGIC	0x58
 
@@ -197,6 +199,21 @@ static struct vfsmount *zsmalloc_mnt;
 static const int fullness_threshold_frac = 4;
 static size_t huge_class_size;
 
+/*
+ * Background compaction: every compact_interval_ms, compact the classes
+ * whose unused objects exceed compact_waste_pct of their allocated ones,
+ * spending at most compact_budget_ms of CPU time per run. The next run
+ * resumes from the class where the previous one ran out of budget.
+ * An interval of 0 disables it.
+ */
+static unsigned int zs_compact_interval_ms;
+static unsigned int zs_compact_waste_pct = 25;
+static unsigned int zs_compact_budget_ms = 2;
+
+/* pools kicked when background compaction is (re)configured */
+static LIST_HEAD(zs_pools);
+static DEFINE_MUTEX(zs_pools_lock);
+
 struct size_class {
 	spinlock_t lock;
 	struct list_head fullness_list[NR_ZS_FULLNESS];
@@ -262,6 +279,10 @@ struct zs_pool {
 
 	/* Compact classes */
 	struct shrinker shrinker;
+	struct delayed_work compact_work;
+	/* class index the next background compaction starts from */
+	int compact_cursor;
+	struct list_head list;
 
 #ifdef CONFIG_ZSMALLOC_STAT
 	struct dentry *stat_dentry;
@@ -1271,13 +1292,20 @@ void *zs_map_object(struct zs_pool *pool, unsigned long handle,
 	obj_to_location(obj, &page, &obj_idx);
 	zspage = get_zspage(page);
 
-	/* migration cannot move any subpage in this zspage */
-	migrate_read_lock(zspage);
-
 	get_zspage_mapping(zspage, &class_idx, &fg);
 	class = pool->size_class[class_idx];
 	off = (class->size * obj_idx) & ~PAGE_MASK;
 
+	/*
+	 * zs_page_migrate() and the compactor trylock the pin of every
+	 * object starting in the page they move, so the pin alone keeps an
+	 * object which doesn't cross a page boundary in place. Only objects
+	 * spanning two pages need the zspage lock, to keep the second page
+	 * from being migrated under us.
+	 */
+	if (off + class->size > PAGE_SIZE)
+		migrate_read_lock(zspage);
+
 	area = &get_cpu_var(zs_map_area);
 	area->vm_mm = mm;
 	if (off + class->size <= PAGE_SIZE) {
@@ -1321,9 +1349,10 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 	off = (class->size * obj_idx) & ~PAGE_MASK;
 
 	area = this_cpu_ptr(&zs_map_area);
-	if (off + class->size <= PAGE_SIZE)
+	if (off + class->size <= PAGE_SIZE) {
 		kunmap_atomic(area->vm_addr);
-	else {
+		put_cpu_var(zs_map_area);
+	} else {
 		struct page *pages[2];
 
 		pages[0] = page;
@@ -1331,10 +1360,10 @@ void zs_unmap_object(struct zs_pool *pool, unsigned long handle)
 		BUG_ON(!pages[1]);
 
 		__zs_unmap_object(area, pages, off, class->size);
+		put_cpu_var(zs_map_area);
+		migrate_read_unlock(zspage);
 	}
-	put_cpu_var(zs_map_area);
 
-	migrate_read_unlock(zspage);
 	unpin_tag(handle);
 }
 EXPORT_SYMBOL_GPL(zs_unmap_object);
@@ -2246,8 +2275,12 @@ static unsigned long zs_can_compact(struct size_class *class)
 	return obj_wasted * class->pages_per_zspage;
 }
 
+/*
+ * Compact @class until nothing more can be freed or, if @deadline is not
+ * zero, until local_clock() passes it.
+ */
 static unsigned long __zs_compact(struct zs_pool *pool,
-				  struct size_class *class)
+				  struct size_class *class, u64 deadline)
 {
 	struct zs_compact_control cc;
 	struct zspage *src_zspage;
@@ -2285,6 +2318,8 @@ static unsigned long __zs_compact(struct zs_pool *pool,
 			pages_freed += class->pages_per_zspage;
 		}
 		spin_unlock(&class->lock);
+		if (deadline && local_clock() >= deadline)
+			return pages_freed;
 		cond_resched();
 		spin_lock(&class->lock);
 	}
@@ -2309,7 +2344,7 @@ unsigned long zs_compact(struct zs_pool *pool)
 			continue;
 		if (class->index != i)
 			continue;
-		pages_freed += __zs_compact(pool, class);
+		pages_freed += __zs_compact(pool, class, 0);
 	}
 	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
 
@@ -2317,6 +2352,94 @@ unsigned long zs_compact(struct zs_pool *pool)
 }
 EXPORT_SYMBOL_GPL(zs_compact);
 
+/*
+ * A class is worth compacting in the background once at least one zspage
+ * can be freed and its unused objects exceed compact_waste_pct of the
+ * allocated ones.
+ */
+static bool zs_class_fragmented(struct size_class *class)
+{
+	unsigned long obj_allocated, obj_used, freeable;
+
+	spin_lock(&class->lock);
+	obj_allocated = zs_stat_get(class, OBJ_ALLOCATED);
+	obj_used = zs_stat_get(class, OBJ_USED);
+	freeable = zs_can_compact(class);
+	spin_unlock(&class->lock);
+
+	if (!freeable)
+		return false;
+
+	return (obj_allocated - obj_used) * 100 >=
+		obj_allocated * READ_ONCE(zs_compact_waste_pct);
+}
+
+static void zs_compact_work(struct work_struct *work)
+{
+	struct zs_pool *pool = container_of(to_delayed_work(work),
+					struct zs_pool, compact_work);
+	unsigned int interval = READ_ONCE(zs_compact_interval_ms);
+	unsigned long pages_freed = 0;
+	struct size_class *class;
+	u64 deadline;
+	int i, nr;
+
+	if (!interval)
+		return;
+
+	deadline = local_clock() +
+		(u64)READ_ONCE(zs_compact_budget_ms) * NSEC_PER_MSEC;
+
+	for (i = pool->compact_cursor, nr = 0; nr < ZS_SIZE_CLASSES; nr++) {
+		class = pool->size_class[i];
+		if (class && class->index == i && zs_class_fragmented(class)) {
+			pages_freed += __zs_compact(pool, class, deadline);
+			if (local_clock() >= deadline)
+				break;
+		}
+
+		i = i ? i - 1 : ZS_SIZE_CLASSES - 1;
+	}
+	pool->compact_cursor = i;
+	atomic_long_add(pages_freed, &pool->stats.pages_compacted);
+
+	schedule_delayed_work(&pool->compact_work, msecs_to_jiffies(interval));
+}
+
+static int zs_compact_interval_set(const char *val,
+				const struct kernel_param *kp)
+{
+	struct zs_pool *pool;
+	int ret;
+
+	ret = param_set_uint(val, kp);
+	if (ret)
+		return ret;
+
+	mutex_lock(&zs_pools_lock);
+	list_for_each_entry(pool, &zs_pools, list)
+		mod_delayed_work(system_wq, &pool->compact_work, 0);
+	mutex_unlock(&zs_pools_lock);
+
+	return 0;
+}
+
+static const struct kernel_param_ops zs_compact_interval_ops = {
+	.set = zs_compact_interval_set,
+	.get = param_get_uint,
+};
+
+module_param_cb(compact_interval_ms, &zs_compact_interval_ops,
+		&zs_compact_interval_ms, 0644);
+MODULE_PARM_DESC(compact_interval_ms,
+		"Background compaction period in ms, 0 disables it");
+module_param_named(compact_waste_pct, zs_compact_waste_pct, uint, 0644);
+MODULE_PARM_DESC(compact_waste_pct,
+		"Percentage of unused objects above which a class is compacted");
+module_param_named(compact_budget_ms, zs_compact_budget_ms, uint, 0644);
+MODULE_PARM_DESC(compact_budget_ms,
+		"CPU time budget of a background compaction run in ms");
+
 void zs_pool_stats(struct zs_pool *pool, struct zs_pool_stats *stats)
 {
 	memcpy(stats, &pool->stats, sizeof(struct zs_pool_stats));
@@ -2398,6 +2521,9 @@ struct zs_pool *zs_create_pool(const char *name)
 		return NULL;
 
 	init_deferred_free(pool);
+	INIT_DELAYED_WORK(&pool->compact_work, zs_compact_work);
+	INIT_LIST_HEAD(&pool->list);
+	pool->compact_cursor = ZS_SIZE_CLASSES - 1;
 
 	pool->name = kstrdup(name, GFP_KERNEL);
 	if (!pool->name)
@@ -2495,6 +2621,13 @@ struct zs_pool *zs_create_pool(const char *name)
 	 */
 	zs_register_shrinker(pool);
 
+	mutex_lock(&zs_pools_lock);
+	list_add(&pool->list, &zs_pools);
+	if (zs_compact_interval_ms)
+		schedule_delayed_work(&pool->compact_work,
+				msecs_to_jiffies(zs_compact_interval_ms));
+	mutex_unlock(&zs_pools_lock);
+
 	return pool;
 
 err:
@@ -2507,6 +2640,11 @@ void zs_destroy_pool(struct zs_pool *pool)
 {
 	int i;
 
+	mutex_lock(&zs_pools_lock);
+	list_del_init(&pool->list);
+	mutex_unlock(&zs_pools_lock);
+	cancel_delayed_work_sync(&pool->compact_work);
+
 	zs_unregister_shrinker(pool);
 	zs_unregister_migration(pool);
 	zs_pool_stat_destroy(pool);
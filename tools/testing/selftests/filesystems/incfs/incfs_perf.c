@@ -6,6 +6,7 @@
 #include <fcntl.h>
 #include <getopt.h>
 #include <lz4.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -16,6 +17,7 @@
 #include <time.h>
 #include <ctype.h>
 #include <unistd.h>
+#include <zstd.h>
 
 #include "utils.h"
 
@@ -36,8 +38,10 @@ struct options {
 	bool no_native; /* -n don't test native files */
 	bool no_random; /* -r don't do random reads*/
 	bool no_linear; /* -R random reads only */
+	int readers; /* -p number of parallel readers */
 	size_t size; /* -s file size as power of 2 */
 	int tries; /* -t times to run test*/
+	bool zstd; /* -z compress with zstd instead of lz4 */
 };
 
 enum flags {
@@ -71,10 +75,13 @@ void print_help(void)
 	"\t                If a letter is omitted, both options are tested\n"
 	"\t                If no letter are given, incfs is not tested\n"
 	"\t-n              Don't test native files\n"
+	"\t-pn (default 1) Number of parallel readers, each reading an\n"
+	"\t                interleaved share of the blocks\n"
 	"\t-r              No random reads (sequential only)\n"
 	"\t-R              Random reads only (no sequential)\n"
 	"\t-sn (default 30)File size as power of 2\n"
 	"\t-tn (default 5) Number of tries per file. Results are averaged\n"
+	"\t-z              Compress blocks with zstd instead of lz4\n"
 	);
 }
 
@@ -85,13 +92,14 @@ int parse_options(int argc, char *const *argv, struct options *options)
 	/* Set defaults here */
 	*options = (struct options){
 		.blocks = 8,
+		.readers = 1,
 		.test_dir = ".",
 		.tries = 5,
 		.size = 30,
 	};
 
 	/* Load options from command line here */
-	while ((c = getopt(argc, argv, "b:cd:f::hnrRs:t:")) != -1) {
+	while ((c = getopt(argc, argv, "b:cd:f::hnp:rRs:t:z")) != -1) {
 		switch (c) {
 		case 'b':
 			options->blocks = strtol(optarg, NULL, 10);
@@ -120,6 +128,10 @@ int parse_options(int argc, char *const *argv, struct options *options)
 			options->no_native = true;
 			break;
 
+		case 'p':
+			options->readers = strtol(optarg, NULL, 10);
+			break;
+
 		case 'r':
 			options->no_random = true;
 			break;
@@ -136,12 +148,21 @@ int parse_options(int argc, char *const *argv, struct options *options)
 			options->tries = strtol(optarg, NULL, 10);
 			break;
 
+		case 'z':
+			options->zstd = true;
+			break;
+
 		default:
 			print_help();
 			return -EINVAL;
 		}
 	}
 
+	if (options->readers < 1) {
+		print_help();
+		return -EINVAL;
+	}
+
 	options->size = 1L << options->size;
 
 	return 0;
@@ -183,7 +204,8 @@ int get_free_memory(void)
 	return strtol(value, NULL, 10);
 }
 
-int write_data(int cmd_fd, int dir_fd, const char *name, size_t size, int flags)
+int write_data(int cmd_fd, int dir_fd, const char *name, size_t size, int flags,
+	       bool zstd)
 {
 	int fd = openat(dir_fd, name, O_RDWR | O_CLOEXEC);
 	struct incfs_permit_fill permit_fill = {
@@ -226,15 +248,23 @@ int write_data(int cmd_fd, int dir_fd, const char *name, size_t size, int flags)
 		shuffle(blocks, block_count);
 
 	if (flags & COMPRESS) {
-		size_t comp_size = LZ4_compress_default(
-			(char *)data, (char *)compressed_data, sizeof(data),
-			ARRAY_SIZE(compressed_data));
-
-		if (comp_size <= 0) {
+		size_t comp_size;
+
+		if (zstd)
+			comp_size = ZSTD_compress(compressed_data,
+						  sizeof(compressed_data), data,
+						  sizeof(data), 1);
+		else
+			comp_size = LZ4_compress_default(
+				(char *)data, (char *)compressed_data,
+				sizeof(data), ARRAY_SIZE(compressed_data));
+
+		if (comp_size <= 0 || (zstd && ZSTD_isError(comp_size))) {
 			error = -EBADMSG;
 			goto out;
 		}
-		fill_block.compression = COMPRESSION_LZ4;
+		fill_block.compression = zstd ? COMPRESSION_ZSTD :
+						COMPRESSION_LZ4;
 		fill_block.data = ptr_to_u64(compressed_data);
 		fill_block.data_len = comp_size;
 	}
@@ -263,6 +293,93 @@ int write_data(int cmd_fd, int dir_fd, const char *name, size_t size, int flags)
 	return error;
 }
 
+struct reader_args {
+	int fd;
+	const size_t *offsets;
+	size_t offsets_size;
+	size_t buffer_size;
+	int index;
+	int count;
+	int err;
+};
+
+/* Read every count-th offset starting at index */
+static void *reader(void *data)
+{
+	struct reader_args *args = data;
+	char *buffer = malloc(args->buffer_size);
+	size_t i;
+
+	if (!buffer) {
+		args->err = -ENOMEM;
+		return NULL;
+	}
+
+	for (i = args->index; i < args->offsets_size; i += args->count)
+		if (pread(args->fd, buffer, args->buffer_size,
+			  args->offsets[i]) != args->buffer_size) {
+			args->err = -errno;
+			break;
+		}
+
+	free(buffer);
+	return NULL;
+}
+
+static int read_offsets(int fd, const size_t *offsets, size_t offsets_size,
+			size_t buffer_size, int readers)
+{
+	pthread_t *threads = calloc(readers, sizeof(*threads));
+	struct reader_args *args = calloc(readers, sizeof(*args));
+	int err = 0;
+	int i;
+
+	if (!threads || !args) {
+		err_msg("Not enough memory");
+		err = -ENOMEM;
+		goto out;
+	}
+
+	for (i = 0; i < readers; ++i) {
+		args[i] = (struct reader_args){
+			.fd = fd,
+			.offsets = offsets,
+			.offsets_size = offsets_size,
+			.buffer_size = buffer_size,
+			.index = i,
+			.count = readers,
+		};
+
+		if (readers == 1) {
+			reader(args);
+			break;
+		}
+
+		if (pthread_create(threads + i, NULL, reader, args + i)) {
+			err_msg("Failed to create thread");
+			err = -errno;
+			break;
+		}
+	}
+
+	if (readers > 1)
+		for (; i > 0; --i)
+			if (pthread_join(threads[i - 1], NULL)) {
+				err_msg("FATAL: failed to join thread");
+				exit(-errno);
+			}
+
+	for (i = 0; i < readers && !err; ++i)
+		err = args[i].err;
+	if (err)
+		err_msg("Failed to read file");
+
+out:
+	free(threads);
+	free(args);
+	return err;
+}
+
 int measure_read_throughput_internal(const char *tag, int dir, const char *name,
 				     const struct options *options, bool random)
 {
@@ -275,14 +392,12 @@ int measure_read_throughput_internal(const char *tag, int dir, const char *name,
 
 	for (block = 0; block < options->blocks; ++block) {
 		size_t buffer_size;
-		char *buffer;
 		int try;
 		double time = 0;
 		double throughput;
 		int memory = 0;
 
 		buffer_size = 1 << (block + 12);
-		buffer = malloc(buffer_size);
 
 		for (try = 0; try < options->tries; ++try) {
 			int err;
@@ -329,13 +444,10 @@ int measure_read_throughput_internal(const char *tag, int dir, const char *name,
 				return err;
 			}
 
-			for (i = 0; i < offsets_size; ++i)
-				if (pread(fd, buffer, buffer_size,
-					  offsets[i]) != buffer_size) {
-					err_msg("Failed to read file");
-					err = -errno;
-					goto fail;
-				}
+			err = read_offsets(fd, offsets, offsets_size,
+					   buffer_size, options->readers);
+			if (err)
+				goto fail;
 
 			err = clock_gettime(CLOCK_MONOTONIC, &end_time);
 			if (err) {
@@ -365,7 +477,6 @@ int measure_read_throughput_internal(const char *tag, int dir, const char *name,
 
 		throughput = options->size * options->tries / time;
 		printf("%10.3e %10d", throughput, memory / options->tries);
-		free(buffer);
 	}
 
 	printf("\n");
@@ -589,12 +700,14 @@ int test_incfs_file(int dst_dir, const struct options *options, int flags)
 		goto fail;
 	}
 
-	if (write_data(cmd_file, dst_dir, name, options->size, flags))
+	if (write_data(cmd_file, dst_dir, name, options->size, flags,
+		       options->zstd))
 		goto fail;
 
 	snprintf(tag, sizeof(tag), "incfs%s%s%s",
 		 flags & SHUFFLE ? "(shuffle)" : "",
-		 flags & COMPRESS ? "(compress)" : "",
+		 flags & COMPRESS ?
+			(options->zstd ? "(zstd)" : "(compress)") : "",
 		 flags & VERIFY ? "(verify)" : "");
 
 	err = measure_read_throughput(tag, dst_dir, name, options);
@@ -4359,6 +4359,24 @@ static int stat_test(const char *mount_dir)
 
 #define SYSFS_DIR "/sys/fs/incremental-fs/instances/test_node/"
 
+static int sysfs_read_value(const char *name, uint64_t *value)
+{
+	int result = TEST_FAILURE;
+	char *filename = NULL;
+	FILE *file = NULL;
+
+	TEST(filename = concat_file_name(SYSFS_DIR, name), filename);
+	TEST(file = fopen(filename, "re"), file);
+	TESTEQUAL(fscanf(file, "%lu", value), 1);
+
+	result = TEST_SUCCESS;
+out:
+	if (file)
+		fclose(file);
+	free(filename);
+	return result;
+}
+
 static int sysfs_test_value(const char *name, uint64_t value)
 {
 	int result = TEST_FAILURE;
@@ -4467,6 +4485,7 @@ static int sysfs_test(const char *mount_dir)
 	TESTEQUAL(sysfs_test_value("reads_failed_hash_verification", 0), 0);
 	TESTEQUAL(read(fd, null_buf, 1), -1);
 	TESTEQUAL(sysfs_test_value("reads_failed_hash_verification", 1), 0);
+	TESTEQUAL(sysfs_test_value("hash_pages_verified", 0), 0);
 	TESTSYSCALL(close(fd));
 	fd = -1;
 
@@ -4572,6 +4591,64 @@ static int sysfs_test_directories(bool one_present, bool two_present)
 	return result;
 }
 
+static int sysfs_hash_pages_test(const char *mount_dir)
+{
+	int result = TEST_FAILURE;
+	char *backing_dir = NULL;
+	int cmd_fd = -1;
+	/* Two layer tree, so each read walks up through two hash pages */
+	int shas_per_block = INCFS_DATA_FILE_BLOCK_SIZE / SHA256_DIGEST_SIZE;
+	struct test_file file = {
+		  .name = "file",
+		  .size = INCFS_DATA_FILE_BLOCK_SIZE * shas_per_block * 2,
+	};
+	char *filename = NULL;
+	char *buf = NULL;
+	int fd = -1;
+	uint64_t verified, cached_first, cached_second;
+
+	TEST(backing_dir = create_backing_dir(mount_dir), backing_dir);
+	TESTEQUAL(mount_fs_opt(mount_dir, backing_dir, "sysfs_name=test_node",
+			       false),
+		  0);
+	TEST(cmd_fd = open_commands_file(mount_dir), cmd_fd != -1);
+	TESTEQUAL(build_mtree(&file), 0);
+	TESTEQUAL(crypto_emit_file(cmd_fd, NULL, file.name, &file.id, file.size,
+				   file.root_hash, file.sig.add_data),
+		  0);
+	TESTEQUAL(emit_test_file_data(mount_dir, &file), 0);
+	TESTEQUAL(load_hash_tree(mount_dir, &file), 0);
+	TEST(filename = concat_file_name(mount_dir, file.name), filename);
+	TEST(buf = malloc(file.size), buf);
+	TEST(fd = open(filename, O_RDONLY | O_CLOEXEC), fd != -1);
+
+	TESTEQUAL(sysfs_test_value("hash_pages_verified", 0), 0);
+	TESTEQUAL(pread(fd, buf, file.size, 0), file.size);
+	TESTEQUAL(sysfs_read_value("hash_pages_verified", &verified), 0);
+	TESTCOND(verified > 0);
+	TESTEQUAL(sysfs_read_value("hash_pages_cached", &cached_first), 0);
+
+	/*
+	 * Only drop the data pages: the verified hash pages cached beyond EOF
+	 * must be trusted by the second read instead of being hashed again.
+	 */
+	TESTEQUAL(posix_fadvise(fd, 0, file.size, POSIX_FADV_DONTNEED), 0);
+	TESTEQUAL(pread(fd, buf, file.size, 0), file.size);
+	TESTEQUAL(sysfs_read_value("hash_pages_cached", &cached_second), 0);
+	TESTCOND(cached_second > cached_first);
+
+	result = TEST_SUCCESS;
+out:
+	free(file.mtree);
+	free(buf);
+	close(fd);
+	free(filename);
+	close(cmd_fd);
+	umount(mount_dir);
+	free(backing_dir);
+	return result;
+}
+
 static int sysfs_rename_test(const char *mount_dir)
 {
 	int result = TEST_FAILURE;
@@ -4757,6 +4834,7 @@ int main(int argc, char *argv[])
 		MAKE_TEST(truncate_test),
 		MAKE_TEST(stat_test),
 		MAKE_TEST(sysfs_test),
+		MAKE_TEST(sysfs_hash_pages_test),
 		MAKE_TEST(sysfs_rename_test),
 	};
 #undef MAKE_TEST